@@ -0,0 +1,919 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef INP4FF_USE_LUT
+#   define INP4_LUT_IMPLEMENTATION
+#endif
+#include <inp4ff.h>
+#include <inp4cf.h>
+
+/* Position mode the benchmark has been compiled with */
+#if defined(INP4FF_USE_FIXED_POS)
+#   define BENCH_MODE "fixed 32.32"
+#elif defined(INP4FF_USE_INDEXED_POS)
+#   define BENCH_MODE "indexed"
+#elif defined(INP4FF_USE_FLOAT32_POS)
+#   define BENCH_MODE "float"
+#else
+#   define BENCH_MODE "double"
+#endif
+
+#ifdef INP4FF_USE_COEFFS
+#   define BENCH_KERNEL "precomputed coefficients"
+#elif defined(INP4FF_USE_LUT)
+#   define BENCH_KERNEL "lookup table"
+#elif defined(INP4FF_USE_AVX2)
+#   define BENCH_KERNEL "avx2"
+#else
+#   define BENCH_KERNEL "scalar"
+#endif
+
+#define BENCH_NUM_OUTPUTS (1 << 22)
+
+/**
+ Measures the time per output sample with src split to segments of nsrcseg
+ samples and dst written in one go. Returns nanoseconds per output.
+ */
+double bench_rate(float rate, int nsrcseg, int num_rounds)
+{
+    int i, round, isrc;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff interp;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_create(ndst, 0);
+        isrc = 0;
+
+        do {
+            int n = nsrc - isrc < nsrcseg ? nsrc - isrc : nsrcseg;
+            inp4ff_process(&interp, dst, ndst, src + isrc, n, rate);
+            isrc += n;
+        } while (interp.state == Inp4State_SrcDepleted && isrc < nsrc);
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+/**
+ bench_rate for inp4ff_process_ratio with the rate down / up
+ */
+double bench_ratio(int up, int down, int nsrcseg, int num_rounds)
+{
+    int i, round, isrc;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)(((long long)ndst * down) / up) + 4;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    inp4ff_ratio* ratio = (inp4ff_ratio*)malloc(sizeof(inp4ff_ratio));
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff interp;
+
+    inp4ff_ratio_init(ratio, up, down);
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_create_ratio(ndst, 0, ratio);
+        isrc = 0;
+
+        do {
+            int n = nsrc - isrc < nsrcseg ? nsrc - isrc : nsrcseg;
+            inp4ff_process_ratio(&interp, dst, ndst, src + isrc, n);
+            isrc += n;
+        } while (interp.state == Inp4State_SrcDepleted && isrc < nsrc);
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(ratio);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+/**
+ As bench_rate, for nch interleaved or planar channels with a shared position.
+ The total number of outputs is the same as in bench_rate, so the result is
+ nanoseconds per output sample of a channel.
+ */
+double bench_multichannel(int nch, float rate, int nsrcseg, int num_rounds, int planar)
+{
+    int i, c, round, isrc;
+    int ndst = BENCH_NUM_OUTPUTS / nch;
+    int nsrc = (int)(ndst * rate) + 4;
+    float* src = (float*)malloc(sizeof(float) * nsrc * nch);
+    float* dst = (float*)malloc(sizeof(float) * ndst * nch);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff_multi interp;
+    const float* src_ch [INP4FF_MAX_CHANNELS];
+    float* dst_ch [INP4FF_MAX_CHANNELS];
+
+    srand(1);
+    for (i = 0; i < nsrc * nch; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_multi_create(ndst, 0);
+        isrc = 0;
+
+        do {
+            int n = nsrc - isrc < nsrcseg ? nsrc - isrc : nsrcseg;
+            if (planar) {
+                for (c = 0; c < nch; ++c) {
+                    src_ch[c] = src + c * nsrc + isrc;
+                    dst_ch[c] = dst + c * ndst;
+                }
+                inp4ff_process_planar(&interp, dst_ch, ndst, src_ch, n, nch, rate);
+            } else {
+                inp4ff_process_interleaved(&interp, dst, ndst, src + isrc * nch, n, nch, rate);
+            }
+            isrc += n;
+        } while (interp.interp.state == Inp4State_SrcDepleted && isrc < nsrc);
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * nch * num_rounds);
+}
+
+/**
+ Measures num_voices voices reading one shared sample at their own rates, each
+ writing blocks of nblock outputs as a sampler would, either one state per
+ voice or in batches. Returns nanoseconds per output.
+ */
+double bench_voices(int num_voices, int nblock, int batched)
+{
+    int i, v, l, block;
+    const int nsrc = 1 << 16;
+    const int num_blocks = nsrc / 2 / nblock - 1;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * nblock * num_voices);
+    inp4ff* voices = (inp4ff*)malloc(sizeof(inp4ff) * num_voices);
+    inp4ff_batch* batches = (inp4ff_batch*)malloc(sizeof(inp4ff_batch) * (num_voices / INP4FF_BATCH_LANES));
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * num_voices);
+    const float* lane_src [INP4FF_BATCH_LANES];
+    float* lane_dst [INP4FF_BATCH_LANES];
+    int lane_nsrc [INP4FF_BATCH_LANES], lane_ndst [INP4FF_BATCH_LANES];
+    volatile float sink = 0.0f;
+    clock_t start, end;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* rates up to 2, the voices never reach the end of src */
+    for (v = 0; v < num_voices; ++v)
+    {
+        rates[v] = (t_inp4ff_pos)(0.5 + 1.5 * rand() / RAND_MAX);
+        voices[v] = inp4ff_create(nblock * num_blocks, 0);
+    }
+    for (i = 0; i < num_voices / INP4FF_BATCH_LANES; ++i)
+    {
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+        {
+            inp4ff_batch_start(&batches[i], l, nblock * num_blocks, 0);
+        }
+    }
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+    {
+        lane_src[l] = src;
+        lane_nsrc[l] = nsrc;
+        lane_ndst[l] = nblock;
+    }
+
+    start = clock();
+
+    for (block = 0; block < num_blocks; ++block)
+    {
+        if (batched)
+        {
+            for (i = 0; i < num_voices / INP4FF_BATCH_LANES; ++i)
+            {
+                for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+                {
+                    lane_dst[l] = dst + (i * INP4FF_BATCH_LANES + l) * nblock;
+                }
+                inp4ff_process_batch(&batches[i], lane_dst, lane_ndst, lane_src, lane_nsrc, rates + i * INP4FF_BATCH_LANES);
+            }
+        }
+        else
+        {
+            for (v = 0; v < num_voices; ++v)
+            {
+                inp4ff_process(&voices[v], dst + v * nblock, nblock, src, nsrc, rates[v]);
+            }
+        }
+
+        sink += dst[block % (nblock * num_voices)];
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(voices); free(batches); free(rates);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)num_voices * nblock * num_blocks);
+}
+
+/**
+ Measures num_voices voices in stacks of 8 slightly detuned voices per sample,
+ stored in random order, either processed in storage order or grouped by the
+ scheduler on every block. Returns nanoseconds per output.
+ */
+double bench_schedule(int num_voices, int nblock, int stack, int scheduled)
+{
+    int i, v, block;
+    const int nsrc = 1 << 15, num_srcs = num_voices / stack;
+    const int num_blocks = nsrc / 2 / nblock - 1;
+    float* src = (float*)malloc(sizeof(float) * nsrc * num_srcs);
+    float* dst = (float*)malloc(sizeof(float) * nblock * num_voices);
+    inp4ff* states = (inp4ff*)malloc(sizeof(inp4ff) * num_voices);
+    inp4ff_voice* voices = (inp4ff_voice*)malloc(sizeof(inp4ff_voice) * num_voices);
+    int* order = (int*)malloc(sizeof(int) * num_voices);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+
+    srand(1);
+    for (i = 0; i < nsrc * num_srcs; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* shuffled, so that neighbouring voices rarely share a sample */
+    for (v = 0; v < num_voices; ++v)
+    {
+        order[v] = v;
+    }
+    for (v = num_voices - 1; v > 0; --v)
+    {
+        i = rand() % (v + 1);
+        block = order[v]; order[v] = order[i]; order[i] = block;
+    }
+
+    for (v = 0; v < num_voices; ++v)
+    {
+        const int s = order[v] / stack;
+        states[v] = inp4ff_create(nblock * num_blocks, 0);
+        voices[v].interp = &states[v];
+        voices[v].dst = dst + v * nblock;
+        voices[v].ndst = nblock;
+        voices[v].src = src + s * nsrc;
+        voices[v].nsrc = nsrc;
+        voices[v].rate = (t_inp4ff_pos)((0.5 + 1.4 * (s % 7) / 6.0) * (1.0 + 0.002 * (order[v] % stack)));
+    }
+    for (v = 0; v < num_voices; ++v)
+    {
+        order[v] = v;
+    }
+
+    start = clock();
+
+    for (block = 0; block < num_blocks; ++block)
+    {
+        if (scheduled)
+        {
+            inp4ff_schedule(voices, order, num_voices);
+            inp4ff_process_voices(voices, order, num_voices);
+        }
+        else
+        {
+            for (v = 0; v < num_voices; ++v)
+            {
+                inp4ff_process(voices[v].interp, voices[v].dst, nblock, voices[v].src, nsrc, voices[v].rate);
+            }
+        }
+
+        sink += dst[block % (nblock * num_voices)];
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(states); free(voices); free(order);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)num_voices * nblock * num_blocks);
+}
+
+/**
+ Measures I/Q samples, either through one complex interpolator or through two
+ real ones on the split parts. Returns nanoseconds per complex output.
+ */
+double bench_complex(float rate, int nsrcseg, int num_rounds, int split)
+{
+    int i, round, isrc, n;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    t_inp4cf_src* src = (t_inp4cf_src*)malloc(sizeof(t_inp4cf_src) * nsrc);
+    t_inp4cf_dst* dst = (t_inp4cf_dst*)malloc(sizeof(t_inp4cf_dst) * ndst);
+    float* re = (float*)malloc(sizeof(float) * nsrc);
+    float* im = (float*)malloc(sizeof(float) * nsrc);
+    float* re_dst = (float*)malloc(sizeof(float) * ndst);
+    float* im_dst = (float*)malloc(sizeof(float) * ndst);
+    const t_inp4cf_src zero = { 0.0f, 0.0f };
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4cf interp;
+    inp4ff re_interp, im_interp;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i].re = re[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+        src[i].im = im[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4cf_create(ndst, zero);
+        re_interp = inp4ff_create(ndst, 0);
+        im_interp = inp4ff_create(ndst, 0);
+        isrc = 0;
+
+        do {
+            n = nsrc - isrc < nsrcseg ? nsrc - isrc : nsrcseg;
+            if (split)
+            {
+                inp4ff_process(&re_interp, re_dst, ndst, re + isrc, n, rate);
+                inp4ff_process(&im_interp, im_dst, ndst, im + isrc, n, rate);
+            }
+            else
+            {
+                inp4cf_process(&interp, dst, ndst, src + isrc, n, rate);
+            }
+            isrc += n;
+        } while ((split ? re_interp.state : interp.state) == Inp4State_SrcDepleted && isrc < nsrc);
+
+        sink += split ? re_dst[round % ndst] + im_dst[round % ndst] : dst[round % ndst].re + dst[round % ndst].im;
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(re); free(im); free(re_dst); free(im_dst);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+/**
+ Measures num_voices voices mixed into one bus of nblock outputs with a gain
+ each, either straight into the bus or through a scratch buffer added to the
+ bus after. A stereo bus gets the voices panned, with a gain ramp over each
+ block. Returns nanoseconds per output of a voice.
+ */
+double bench_mix(int num_voices, int nblock, int stereo, int fused)
+{
+    int i, v, block;
+    const int nsrc = 1 << 16;
+    const int num_blocks = nsrc / 2 / nblock - 1;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* bus = (float*)malloc(sizeof(float) * nblock);
+    float* right = (float*)malloc(sizeof(float) * nblock);
+    float* scratch = (float*)malloc(sizeof(float) * nblock);
+    inp4ff* voices = (inp4ff*)malloc(sizeof(inp4ff) * num_voices);
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * num_voices);
+    float* gains = (float*)malloc(sizeof(float) * num_voices);
+    float gain, step;
+    volatile float sink = 0.0f;
+    clock_t start, end;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    for (v = 0; v < num_voices; ++v)
+    {
+        rates[v] = (t_inp4ff_pos)(0.5 + 1.5 * rand() / RAND_MAX);
+        gains[v] = (float)rand() / (float)RAND_MAX / num_voices;
+        voices[v] = inp4ff_create(nblock * num_blocks, 0);
+    }
+
+    start = clock();
+
+    for (block = 0; block < num_blocks; ++block)
+    {
+        for (i = 0; i < nblock; ++i)
+        {
+            bus[i] = right[i] = 0.0f;
+        }
+
+        for (v = 0; v < num_voices; ++v)
+        {
+            if (stereo && fused)
+            {
+                inp4ff_process_stereo(&voices[v], bus, right, nblock, src, nsrc, rates[v],
+                                      gains[v], 0.99f * gains[v], 0.8f, 0.6f, 1);
+            }
+            else if (fused)
+            {
+                inp4ff_process_mix(&voices[v], bus, nblock, src, nsrc, rates[v], gains[v]);
+            }
+            else
+            {
+                inp4ff_process(&voices[v], scratch, nblock, src, nsrc, rates[v]);
+
+                if (stereo)
+                {
+                    step = (0.99f * gains[v] - gains[v]) / nblock;
+
+                    for (i = 0; i < nblock; ++i)
+                    {
+                        gain = (gains[v] + i * step) * scratch[i];
+                        bus[i] += 0.8f * gain;
+                        right[i] += 0.6f * gain;
+                    }
+                }
+                else
+                {
+                    for (i = 0; i < nblock; ++i)
+                    {
+                        bus[i] += gains[v] * scratch[i];
+                    }
+                }
+            }
+        }
+
+        sink += bus[block % nblock] + right[block % nblock];
+    }
+
+    end = clock();
+
+    free(src); free(bus); free(right); free(scratch); free(voices); free(rates); free(gains);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)num_voices * nblock * num_blocks);
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+/**
+ bench_rate with a vibrato of depth around centre, through
+ inp4ff_process_varirate or through a call of inp4ff_process per output.
+ */
+double bench_varirate(float centre, float depth, int nsrcseg, int num_rounds, int per_sample)
+{
+    int i, round, isrc, n;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)ceil(ndst * (centre + depth)) + 3;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * ndst);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff interp;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (i = 0; i < ndst; ++i)
+    {
+        rates[i] = centre + depth * (t_inp4ff_pos)sin(0.001 * i);
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_create(ndst, 0);
+        isrc = 0;
+        i = 0;
+
+        do {
+            n = nsrc - isrc < nsrcseg ? nsrc - isrc : nsrcseg;
+
+            if (per_sample)
+            {
+                /* one output at a time, the state goes dst depleted after each */
+                do {
+                    inp4ff_process(&interp, dst + i, 1, src + isrc, n, rates[i]);
+                    if (interp.state != Inp4State_SrcDepleted) i++;
+                } while (interp.state != Inp4State_SrcDepleted && i < ndst);
+            }
+            else
+            {
+                inp4ff_process_varirate(&interp, dst, ndst, src + isrc, n, rates);
+            }
+
+            isrc += n;
+        } while (interp.state == Inp4State_SrcDepleted && isrc < nsrc);
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(rates);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+/**
+ bench_rate with the rate gliding from rate_start to rate_end and back over
+ blocks of nblock outputs, through inp4ff_process_ramp or through
+ inp4ff_process_varirate with the same rates written out.
+ */
+double bench_ramp(float rate_start, float rate_end, int nblock, int num_rounds, int varirate)
+{
+    int i, round, isrc, idst, n;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)ceil(ndst * (rate_start > rate_end ? rate_start : rate_end)) + 3;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * nblock * 2);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff interp;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (i = 0; i < nblock; ++i)
+    {
+        rates[i] = rate_start + i * ((rate_end - rate_start) / nblock);
+        rates[nblock + i] = rate_end + i * ((rate_start - rate_end) / nblock);
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_create(ndst, 0);
+        isrc = 0;
+
+        for (idst = 0; idst + nblock <= ndst; idst += nblock)
+        {
+            /* up on even blocks, down on odd */
+            const int down = (idst / nblock) & 1;
+
+            do {
+                n = nsrc - isrc < 4096 ? nsrc - isrc : 4096;
+
+                if (varirate)
+                {
+                    inp4ff_process_varirate(&interp, dst + idst, nblock, src + isrc, n, rates + down * nblock);
+                }
+                else
+                {
+                    inp4ff_process_ramp(&interp, dst + idst, nblock, src + isrc, n,
+                                        down ? rate_end : rate_start, down ? rate_start : rate_end);
+                }
+
+                if (interp.state != Inp4State_DstDepleted) isrc += n;
+            } while (interp.state == Inp4State_SrcDepleted && isrc < nsrc);
+        }
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst); free(rates);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+#endif
+
+/**
+ A chorus on a delay line of size samples, written and read in blocks of
+ nblock with the delay swept over most of the line. Reads through
+ inp4ff_delay_read, or one output at a time with each tap wrapped around on
+ its own. Returns nanoseconds per output.
+ */
+double bench_delay(int size, int nblock, int num_rounds, int guarded)
+{
+    int i, k, q, round, it;
+    int ndst = BENCH_NUM_OUTPUTS;
+    float* src = (float*)malloc(sizeof(float) * ndst);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    t_inp4ff_pos* delays = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * ndst);
+    t_inp4ff_src x [4];
+    t_inp4ff_pos t;
+    unsigned int base;
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff_delay delay;
+
+    size = inp4ff_delay_init(&delay, size);
+
+    srand(1);
+    for (i = 0; i < ndst; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+        delays[i] = (t_inp4ff_pos)(2.0 + (size - nblock - 3) * (0.5 + 0.5 * sin(0.0001 * i)));
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        for (i = 0; i + nblock <= ndst; i += nblock)
+        {
+            inp4ff_delay_write(&delay, src + i, nblock);
+
+            if (guarded)
+            {
+                inp4ff_delay_read(&delay, dst + i, nblock, delays + i);
+            }
+            else
+            {
+                base = delay.write_index - (unsigned int)nblock - 1;
+
+                for (k = 0; k < nblock; ++k)
+                {
+                    t = (t_inp4ff_pos)k - delays[i + k];
+                    it = INP4FF_FLOOR_INT(t);
+                    for (q = 0; q < 4; ++q)
+                    {
+                        x[q] = delay.data[(base + it + q) & delay.mask];
+                    }
+                    dst[i + k] = inp4ff__cubic_interp(x, t - it);
+                }
+            }
+        }
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    inp4ff_delay_free(&delay);
+    free(src); free(dst); free(delays);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+/**
+ num_taps taps of a delay line at delays fixed for each block of nblock,
+ through inp4ff_delay_read_taps or a call of inp4ff_delay_read per tap.
+ Returns nanoseconds per tap output.
+ */
+double bench_taps(int num_taps, int nblock, int num_rounds, int batched)
+{
+    int i, j, k, round;
+    const int size = 1 << 16, num_blocks = (BENCH_NUM_OUTPUTS / num_taps) / nblock;
+    float* src = (float*)malloc(sizeof(float) * nblock * num_blocks);
+    float* out [32];
+    t_inp4ff_pos* delays = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * num_taps * (nblock + 1));
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff_delay delay;
+
+    inp4ff_delay_init(&delay, size);
+
+    srand(1);
+    for (i = 0; i < nblock * num_blocks; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* the delays of the taps, and the same written out for each output */
+    for (j = 0; j < num_taps; ++j)
+    {
+        out[j] = (float*)malloc(sizeof(float) * nblock);
+        delays[j] = (t_inp4ff_pos)(2.0 + (size - nblock - 3) * (double)rand() / RAND_MAX);
+
+        for (k = 0; k < nblock; ++k)
+        {
+            delays[num_taps + j * nblock + k] = delays[j];
+        }
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        for (i = 0; i < num_blocks; ++i)
+        {
+            inp4ff_delay_write(&delay, src + i * nblock, nblock);
+
+            if (batched)
+            {
+                inp4ff_delay_read_taps(&delay, out, nblock, delays, num_taps);
+            }
+            else
+            {
+                for (j = 0; j < num_taps; ++j)
+                {
+                    inp4ff_delay_read(&delay, out[j], nblock, delays + num_taps + j * nblock);
+                }
+            }
+
+            sink += out[i % num_taps][0];
+        }
+    }
+
+    end = clock();
+
+    for (j = 0; j < num_taps; ++j)
+    {
+        free(out[j]);
+    }
+    inp4ff_delay_free(&delay);
+    free(src); free(delays);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)num_taps * nblock * num_blocks * num_rounds);
+}
+
+/**
+ Plays src backwards with a negative rate, fed in segments of nsrcseg from
+ its end, in ns per output. Compare with bench_rate at the same rate.
+ */
+double bench_reverse(float rate, int nsrcseg, int num_rounds)
+{
+    int i, round, isrc;
+    int ndst = BENCH_NUM_OUTPUTS;
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    volatile float sink = 0.0f;
+    clock_t start, end;
+    inp4ff interp;
+
+    srand(1);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    start = clock();
+
+    for (round = 0; round < num_rounds; ++round)
+    {
+        interp = inp4ff_create(ndst, 0);
+        isrc = nsrc;
+
+        do {
+            int n = isrc < nsrcseg ? isrc : nsrcseg;
+            isrc -= n;
+            inp4ff_process(&interp, dst, ndst, src + isrc, n, -rate);
+        } while (interp.state == Inp4State_SrcDepleted && isrc > 0);
+
+        sink += dst[round % ndst];
+    }
+
+    end = clock();
+
+    free(src); free(dst);
+
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ((double)ndst * num_rounds);
+}
+
+int main()
+{
+    static const float rates[] = { 0.05f, 0.1f, 0.25f, 0.5f, 0.918f, 1.0f, 1.5f, 2.0f, 3.7f };
+    static const int segments[] = { 64, 4096 };
+    static const int ratios[][2] = { { 160, 147 }, { 2, 1 }, { 1001, 1000 } }; /* up, down */
+    static const int channels[] = { 1, 2, 4, 6, 8 };
+    int r, s, seg;
+
+    printf("inp4ff benchmark, %s positions, %s kernel\n", BENCH_MODE, BENCH_KERNEL);
+#ifdef INP4FF_USE_LUT
+    printf("%i phases, quantization error %.1f dB\n", INP4_LUT_PHASES, inp4_lut_error_db(INP4_LUT_PHASES));
+#endif
+    printf("%8s %8s %12s\n", "rate", "nsrcseg", "ns/sample");
+
+    for (s = 0; s < (int)(sizeof(segments) / sizeof(segments[0])); ++s)
+    {
+        for (r = 0; r < (int)(sizeof(rates) / sizeof(rates[0])); ++r)
+        {
+            printf("%8.3f %8i %12.3f\n", rates[r], segments[s], bench_rate(rates[r], segments[s], 8));
+        }
+    }
+
+    /* short segments are dominated by the boundary between the context and src */
+    printf("%8s %8s %12s\n", "rate", "nsrcseg", "ns/sample");
+
+    for (seg = 1; seg <= 4096; seg *= 2)
+    {
+        printf("%8.3f %8i %12.3f\n", 0.918f, seg, bench_rate(0.918f, seg, 2));
+    }
+
+    printf("%8s %8s %12s %12s\n", "ratio", "nsrcseg", "ratio ns", "rate ns");
+
+    for (s = 0; s < (int)(sizeof(segments) / sizeof(segments[0])); ++s)
+    {
+        for (r = 0; r < (int)(sizeof(ratios) / sizeof(ratios[0])); ++r)
+        {
+            printf("%4i/%-4i %8i %12.3f %12.3f\n", ratios[r][1], ratios[r][0], segments[s],
+                   bench_ratio(ratios[r][0], ratios[r][1], segments[s], 8),
+                   bench_rate((float)ratios[r][1] / ratios[r][0], segments[s], 8));
+        }
+    }
+
+    /* a shared position against each channel processed on its own */
+    printf("%8s %8s %12s %12s %12s\n", "channels", "rate", "interl. ns", "planar ns", "single ns");
+
+    for (s = 0; s < (int)(sizeof(channels) / sizeof(channels[0])); ++s)
+    {
+        for (r = 0; r < (int)(sizeof(rates) / sizeof(rates[0])); r += 4)
+        {
+            printf("%8i %8.3f %12.3f %12.3f %12.3f\n", channels[s], rates[r],
+                   bench_multichannel(channels[s], rates[r], 4096, 8, 0),
+                   bench_multichannel(channels[s], rates[r], 4096, 8, 1),
+                   bench_rate(rates[r], 4096, 8));
+        }
+    }
+
+    /* many short voices, where the call overhead adds up */
+    printf("%8s %8s %12s %12s\n", "voices", "nblock", "voice ns", "batch ns");
+    printf("%8i %8i %12.3f %12.3f\n", 512, 32, bench_voices(512, 32, 0), bench_voices(512, 32, 1));
+    printf("%8i %8i %12.3f %12.3f\n", 512, 8, bench_voices(512, 8, 0), bench_voices(512, 8, 1));
+
+    /* voices sharing samples, in storage order against grouped by src address */
+    printf("%8s %8s %8s %12s %12s\n", "voices", "nblock", "stack", "stored ns", "sched. ns");
+    printf("%8i %8i %8i %12.3f %12.3f\n", 512, 32, 8, bench_schedule(512, 32, 8, 0), bench_schedule(512, 32, 8, 1));
+    printf("%8i %8i %8i %12.3f %12.3f\n", 512, 32, 1, bench_schedule(512, 32, 1, 0), bench_schedule(512, 32, 1, 1));
+
+    /* voices mixed into a bus, straight or through a scratch buffer */
+    printf("%8s %8s %8s %12s %12s\n", "voices", "nblock", "channels", "mix ns", "scratch ns");
+    printf("%8i %8i %8i %12.3f %12.3f\n", 64, 64, 1, bench_mix(64, 64, 0, 1), bench_mix(64, 64, 0, 0));
+    printf("%8i %8i %8i %12.3f %12.3f\n", 64, 512, 1, bench_mix(64, 512, 0, 1), bench_mix(64, 512, 0, 0));
+    printf("%8i %8i %8i %12.3f %12.3f\n", 64, 64, 2, bench_mix(64, 64, 1, 1), bench_mix(64, 64, 1, 0));
+    printf("%8i %8i %8i %12.3f %12.3f\n", 64, 512, 2, bench_mix(64, 512, 1, 1), bench_mix(64, 512, 1, 0));
+
+    /* I/Q samples through one complex state against a real state per part */
+    printf("%8s %8s %12s %12s\n", "rate", "nsrcseg", "complex ns", "split ns");
+
+    for (r = 0; r < (int)(sizeof(rates) / sizeof(rates[0])); r += 2)
+    {
+        printf("%8.3f %8i %12.3f %12.3f\n", rates[r], 4096, bench_complex(rates[r], 4096, 4, 0), bench_complex(rates[r], 4096, 4, 1));
+    }
+
+#ifndef INP4FF_USE_INDEXED_POS
+    /* a rate per output, against a call of inp4ff_process per output */
+    printf("%8s %8s %12s %12s\n", "rate", "depth", "vari ns", "single ns");
+    printf("%8.3f %8.3f %12.3f %12.3f\n", 1.0f, 0.3f, bench_varirate(1.0f, 0.3f, 4096, 2, 0), bench_varirate(1.0f, 0.3f, 4096, 2, 1));
+    printf("%8.3f %8.3f %12.3f %12.3f\n", 2.2f, 1.5f, bench_varirate(2.2f, 1.5f, 4096, 2, 0), bench_varirate(2.2f, 1.5f, 4096, 2, 1));
+
+    /* glides over each block, against the rates written out and a fixed rate */
+    printf("%8s %8s %8s %12s %12s %12s\n", "from", "to", "nblock", "ramp ns", "vari ns", "fixed ns");
+    printf("%8.3f %8.3f %8i %12.3f %12.3f %12.3f\n", 0.9f, 1.1f, 256, bench_ramp(0.9f, 1.1f, 256, 4, 0), bench_ramp(0.9f, 1.1f, 256, 4, 1), bench_rate(1.01f, 4096, 4));
+    printf("%8.3f %8.3f %8i %12.3f %12.3f %12.3f\n", 0.5f, 2.0f, 256, bench_ramp(0.5f, 2.0f, 256, 4, 0), bench_ramp(0.5f, 2.0f, 256, 4, 1), bench_rate(1.25f, 4096, 4));
+#endif
+
+    /* a delay line read with the guard, against wrapping each tap around */
+    printf("%8s %8s %12s %12s\n", "size", "nblock", "guard ns", "wrap ns");
+    printf("%8i %8i %12.3f %12.3f\n", 1024, 64, bench_delay(1024, 64, 4, 1), bench_delay(1024, 64, 4, 0));
+    printf("%8i %8i %12.3f %12.3f\n", 65536, 256, bench_delay(65536, 256, 4, 1), bench_delay(65536, 256, 4, 0));
+
+    /* taps of a delay line at once, against a read per tap */
+    printf("%8s %8s %12s %12s\n", "taps", "nblock", "taps ns", "read ns");
+    printf("%8i %8i %12.3f %12.3f\n", 8, 64, bench_taps(8, 64, 4, 1), bench_taps(8, 64, 4, 0));
+    printf("%8i %8i %12.3f %12.3f\n", 32, 64, bench_taps(32, 64, 4, 1), bench_taps(32, 64, 4, 0));
+    printf("%8i %8i %12.3f %12.3f\n", 32, 256, bench_taps(32, 256, 4, 1), bench_taps(32, 256, 4, 0));
+
+    /* backward playback, against forward playback at the same rate */
+    printf("%8s %8s %12s %12s\n", "rate", "nsrcseg", "reverse ns", "forward ns");
+
+    for (r = 0; r < (int)(sizeof(rates) / sizeof(rates[0])); r += 2)
+    {
+        printf("%8.3f %8i %12.3f %12.3f\n", rates[r], 4096, bench_reverse(rates[r], 4096, 4), bench_rate(rates[r], 4096, 4));
+    }
+
+    return 0;
+}
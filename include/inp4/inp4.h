@@ -32,6 +32,7 @@ DEALINGS IN THE SOFTWARE.
 #define INP4_H
 
 #include <math.h>
+#include <string.h>
 
 /************
  ** COMMON **
@@ -69,6 +70,13 @@ typedef enum {
 typedef float t_inp4ff_src;
 typedef float t_inp4ff_dst;
 
+/* With INP4FF_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. */
+#ifdef INP4FF_USE_LUT
+#   include "inp4lut.h"
+#endif // INP4FF_USE_LUT
+
 
 typedef struct {
     Inp4State state;                        /* both src and dst can't deplete on the same pass.
@@ -90,6 +98,9 @@ static void inp4ff_init(inp4ff* interp, int num_to_write, t_inp4ff_src initial_s
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4FF_USE_LUT
+    inp4_lut_init();
+#endif
     interp->context[0] = initial_state;
 }
 
@@ -106,6 +117,7 @@ static int           inp4ff__push_to_context    (inp4ff* interp, const t_inp4ff_
 static int           inp4ff__read_from_context  (inp4ff* interp, t_inp4ff_dst* dst, t_inp4ff_pos rate, int n);
 static void          inp4ff__read_from_src      (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, t_inp4ff_pos rate, int n);
 static void          inp4ff__post_process       (inp4ff* interp, const t_inp4ff_src* src, int nsrc);
+static void          inp4ff__copy_from_src     (t_inp4ff_dst* dst, const t_inp4ff_src* src, int step, int n);
 
 static void inp4ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
 {
@@ -160,6 +172,14 @@ static void inp4ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_
 
 static t_inp4ff_dst inp4ff__cubic_interp(const t_inp4ff_src* x, t_inp4ff_pos fract)
 {
+#ifdef INP4FF_USE_LUT
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4ff_pos)(0.5)) * 4];
+
+    return (t_inp4ff_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
     const t_inp4ff_dst x21_diff = x[2] - x[1];
     const t_inp4ff_dst c = (x[3] - x[0] - (t_inp4ff_dst)(3.0) * x21_diff) * fract
                            + (x[3] + (t_inp4ff_dst)(2.0) * x[0] - (t_inp4ff_dst)(3.0) * x[1]);
@@ -171,6 +191,8 @@ static t_inp4ff_dst inp4ff__cubic_interp(const t_inp4ff_src* x, t_inp4ff_pos fra
      */
 
     return value;
+
+#endif
 }
 
 static int inp4ff__push_to_context(inp4ff* interp, const t_inp4ff_src* src, int nsrc)
@@ -232,6 +254,21 @@ static int inp4ff__read_from_context(inp4ff* interp, t_inp4ff_dst* dst, t_inp4ff
     return n;
 }
 
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4ff__copy_from_src(t_inp4ff_dst* dst, const t_inp4ff_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4ff_src) == sizeof(t_inp4ff_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4ff_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4ff_dst)src[i * step];
+    }
+}
+
 static void inp4ff__read_from_src(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, t_inp4ff_pos rate, int n)
 {
     int num_read = n; /* init to n, substract after loop*/
@@ -243,6 +280,13 @@ static void inp4ff__read_from_src(inp4ff* interp, t_inp4ff_dst* dst, const t_inp
 
     dst = dst + interp->dst_index;
 
+    /* At a whole position and a whole rate every output is a src sample */
+    if (pos == INP4FF_FLOOR(pos) && rate == INP4FF_FLOOR(rate) && n > 0) {
+        inp4ff__copy_from_src(dst, &src[(int)pos], (int)rate, n);
+        pos += n * rate;
+        n = 0;
+    }
+
     while (n > 0) {
 
         ipos = (int)(pos);
@@ -313,6 +357,13 @@ static void inp4ff__post_process(inp4ff* interp, const t_inp4ff_src* src, int ns
 typedef float t_inp4fd_src;
 typedef float t_inp4fd_dst;
 
+/* With INP4FD_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. */
+#ifdef INP4FD_USE_LUT
+#   include "inp4lut.h"
+#endif // INP4FD_USE_LUT
+
 
 typedef struct {
     Inp4State state;                             /* both src and dst can't deplete on the same pass.
@@ -334,6 +385,9 @@ static void inp4fd_init(inp4fd* interp, int num_to_write, t_inp4fd_src initial_s
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4FD_USE_LUT
+    inp4_lut_init();
+#endif
     interp->context[0] = initial_state;
 }
 
@@ -349,6 +403,7 @@ static int           inp4fd__push_to_context    (inp4fd* interp, const t_inp4fd_
 static int           inp4fd__read_from_context  (inp4fd* interp, t_inp4fd_dst* dst, t_inp4fd_pos rate, int n);
 static void          inp4fd__read_from_src      (inp4fd* interp, t_inp4fd_dst* dst, const t_inp4fd_src* src, t_inp4fd_pos rate, int n);
 static void          inp4fd__post_process       (inp4fd* interp, const t_inp4fd_src* src, int nsrc);
+static void          inp4fd__copy_from_src     (t_inp4fd_dst* dst, const t_inp4fd_src* src, int step, int n);
 
 static void inp4fd_process(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate)
 {
@@ -403,6 +458,14 @@ static void inp4fd_process(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_
 
 static t_inp4fd_dst inp4fd__cubic_interp(const t_inp4fd_src* x, t_inp4fd_pos fract)
 {
+#ifdef INP4FD_USE_LUT
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4fd_pos)(0.5)) * 4];
+
+    return (t_inp4fd_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
     const t_inp4fd_dst x21_difd = x[2] - x[1];
     const t_inp4fd_dst c = (x[3] - x[0] - (t_inp4fd_dst)(3.0) * x21_difd) * fract
                            + (x[3] + (t_inp4fd_dst)(2.0) * x[0] - (t_inp4fd_dst)(3.0) * x[1]);
@@ -414,6 +477,8 @@ static t_inp4fd_dst inp4fd__cubic_interp(const t_inp4fd_src* x, t_inp4fd_pos fra
      */
 
     return value;
+
+#endif
 }
 
 static int inp4fd__push_to_context(inp4fd* interp, const t_inp4fd_src* src, int nsrc)
@@ -475,6 +540,21 @@ static int inp4fd__read_from_context(inp4fd* interp, t_inp4fd_dst* dst, t_inp4fd
     return n;
 }
 
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4fd__copy_from_src(t_inp4fd_dst* dst, const t_inp4fd_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4fd_src) == sizeof(t_inp4fd_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4fd_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4fd_dst)src[i * step];
+    }
+}
+
 static void inp4fd__read_from_src(inp4fd* interp, t_inp4fd_dst* dst, const t_inp4fd_src* src, t_inp4fd_pos rate, int n)
 {
     int num_read = n; /* init to n, substract after loop*/
@@ -486,6 +566,13 @@ static void inp4fd__read_from_src(inp4fd* interp, t_inp4fd_dst* dst, const t_inp
 
     dst = dst + interp->dst_index;
 
+    /* At a whole position and a whole rate every output is a src sample */
+    if (pos == INP4FD_FLOOR(pos) && rate == INP4FD_FLOOR(rate) && n > 0) {
+        inp4fd__copy_from_src(dst, &src[(int)pos], (int)rate, n);
+        pos += n * rate;
+        n = 0;
+    }
+
     while (n > 0) {
 
         ipos = (int)(pos);
@@ -556,6 +643,13 @@ static void inp4fd__post_process(inp4fd* interp, const t_inp4fd_src* src, int ns
 typedef float t_inp4df_src;
 typedef float t_inp4df_dst;
 
+/* With INP4DF_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. */
+#ifdef INP4DF_USE_LUT
+#   include "inp4lut.h"
+#endif // INP4DF_USE_LUT
+
 
 typedef struct {
     Inp4State state;                             /* both src and dst can't deplete on the same pass.
@@ -577,6 +671,9 @@ static void inp4df_init(inp4df* interp, int num_to_write, t_inp4df_src initial_s
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4DF_USE_LUT
+    inp4_lut_init();
+#endif
     interp->context[0] = initial_state;
 }
 
@@ -593,6 +690,7 @@ static int           inp4df__push_to_context    (inp4df* interp, const t_inp4df_
 static int           inp4df__read_from_context  (inp4df* interp, t_inp4df_dst* dst, t_inp4df_pos rate, int n);
 static void          inp4df__read_from_src      (inp4df* interp, t_inp4df_dst* dst, const t_inp4df_src* src, t_inp4df_pos rate, int n);
 static void          inp4df__post_process       (inp4df* interp, const t_inp4df_src* src, int nsrc);
+static void          inp4df__copy_from_src     (t_inp4df_dst* dst, const t_inp4df_src* src, int step, int n);
 
 static void inp4df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate)
 {
@@ -647,6 +745,14 @@ static void inp4df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_
 
 static t_inp4df_dst inp4df__cubic_interp(const t_inp4df_src* x, t_inp4df_pos fract)
 {
+#ifdef INP4DF_USE_LUT
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4df_pos)(0.5)) * 4];
+
+    return (t_inp4df_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
     const t_inp4df_dst x21_didf = x[2] - x[1];
     const t_inp4df_dst c = (x[3] - x[0] - (t_inp4df_dst)(3.0) * x21_didf) * fract
                            + (x[3] + (t_inp4df_dst)(2.0) * x[0] - (t_inp4df_dst)(3.0) * x[1]);
@@ -658,6 +764,8 @@ static t_inp4df_dst inp4df__cubic_interp(const t_inp4df_src* x, t_inp4df_pos fra
      */
 
     return value;
+
+#endif
 }
 
 static int inp4df__push_to_context(inp4df* interp, const t_inp4df_src* src, int nsrc)
@@ -719,6 +827,21 @@ static int inp4df__read_from_context(inp4df* interp, t_inp4df_dst* dst, t_inp4df
     return n;
 }
 
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4df__copy_from_src(t_inp4df_dst* dst, const t_inp4df_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4df_src) == sizeof(t_inp4df_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4df_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4df_dst)src[i * step];
+    }
+}
+
 static void inp4df__read_from_src(inp4df* interp, t_inp4df_dst* dst, const t_inp4df_src* src, t_inp4df_pos rate, int n)
 {
     int num_read = n; /* init to n, substract after loop*/
@@ -730,6 +853,13 @@ static void inp4df__read_from_src(inp4df* interp, t_inp4df_dst* dst, const t_inp
 
     dst = dst + interp->dst_index;
 
+    /* At a whole position and a whole rate every output is a src sample */
+    if (pos == INP4DF_FLOOR(pos) && rate == INP4DF_FLOOR(rate) && n > 0) {
+        inp4df__copy_from_src(dst, &src[(int)pos], (int)rate, n);
+        pos += n * rate;
+        n = 0;
+    }
+
     while (n > 0) {
 
         ipos = (int)(pos);
@@ -799,6 +929,13 @@ static void inp4df__post_process(inp4df* interp, const t_inp4df_src* src, int ns
 typedef float t_inp4dd_src;
 typedef float t_inp4dd_dst;
 
+/* With INP4DD_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. */
+#ifdef INP4DD_USE_LUT
+#   include "inp4lut.h"
+#endif // INP4DD_USE_LUT
+
 
 typedef struct {
     Inp4State state;                             /* both src and dst can't deplete on the same pass.
@@ -820,6 +957,9 @@ static void inp4dd_init(inp4dd* interp, int num_to_write, t_inp4dd_src initial_s
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4DD_USE_LUT
+    inp4_lut_init();
+#endif
     interp->context[0] = initial_state;
 }
 
@@ -836,6 +976,7 @@ static int           inp4dd__push_to_context    (inp4dd* interp, const t_inp4dd_
 static int           inp4dd__read_from_context  (inp4dd* interp, t_inp4dd_dst* dst, t_inp4dd_pos rate, int n);
 static void          inp4dd__read_from_src      (inp4dd* interp, t_inp4dd_dst* dst, const t_inp4dd_src* src, t_inp4dd_pos rate, int n);
 static void          inp4dd__post_process       (inp4dd* interp, const t_inp4dd_src* src, int nsrc);
+static void          inp4dd__copy_from_src     (t_inp4dd_dst* dst, const t_inp4dd_src* src, int step, int n);
 
 static void inp4dd_process(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate)
 {
@@ -890,6 +1031,14 @@ static void inp4dd_process(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_
 
 static t_inp4dd_dst inp4dd__cubic_interp(const t_inp4dd_src* x, t_inp4dd_pos fract)
 {
+#ifdef INP4DD_USE_LUT
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4dd_pos)(0.5)) * 4];
+
+    return (t_inp4dd_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
     const t_inp4dd_dst x21_didd = x[2] - x[1];
     const t_inp4dd_dst c = (x[3] - x[0] - (t_inp4dd_dst)(3.0) * x21_didd) * fract
                            + (x[3] + (t_inp4dd_dst)(2.0) * x[0] - (t_inp4dd_dst)(3.0) * x[1]);
@@ -901,6 +1050,8 @@ static t_inp4dd_dst inp4dd__cubic_interp(const t_inp4dd_src* x, t_inp4dd_pos fra
      */
 
     return value;
+
+#endif
 }
 
 static int inp4dd__push_to_context(inp4dd* interp, const t_inp4dd_src* src, int nsrc)
@@ -962,6 +1113,21 @@ static int inp4dd__read_from_context(inp4dd* interp, t_inp4dd_dst* dst, t_inp4dd
     return n;
 }
 
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4dd__copy_from_src(t_inp4dd_dst* dst, const t_inp4dd_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4dd_src) == sizeof(t_inp4dd_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4dd_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4dd_dst)src[i * step];
+    }
+}
+
 static void inp4dd__read_from_src(inp4dd* interp, t_inp4dd_dst* dst, const t_inp4dd_src* src, t_inp4dd_pos rate, int n)
 {
     int num_read = n; /* init to n, substract after loop*/
@@ -973,6 +1139,13 @@ static void inp4dd__read_from_src(inp4dd* interp, t_inp4dd_dst* dst, const t_inp
 
     dst = dst + interp->dst_index;
 
+    /* At a whole position and a whole rate every output is a src sample */
+    if (pos == INP4DD_FLOOR(pos) && rate == INP4DD_FLOOR(rate) && n > 0) {
+        inp4dd__copy_from_src(dst, &src[(int)pos], (int)rate, n);
+        pos += n * rate;
+        n = 0;
+    }
+
     while (n > 0) {
 
         ipos = (int)(pos);
@@ -0,0 +1,425 @@
+/******************************************************************************
+interpolator4.h
+
+Copyright 2023 Olli Erik Keskinen
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+/* Complex variant of inp4ff.h, for I/Q samples interleaved as re, im pairs.
+   Both parts share the position, so the index and the fraction of an output
+   are computed once for the two. nsrc, ndst and num_to_write count complex
+   samples. */
+
+#ifndef INP4CF_H
+#define INP4CF_H
+
+#include <math.h>
+#include <string.h>
+
+#ifdef INP4CF_USE_AVX2
+#   include <immintrin.h>
+#endif
+
+#ifndef INP4_STATE_ENUM
+#define INP4_STATE_ENUM
+typedef enum {
+    Inp4State_Done = 0,
+    Inp4State_Init,
+    Inp4State_SrcDepleted,
+    Inp4State_DstDepleted,
+} Inp4State;
+#endif // INP4_STATE_ENUM
+
+#ifndef INP4CF_CTX_SIZE
+#   define INP4CF_CTX_SIZE 9
+#endif
+
+/* floor and ceil flavours are determined by the position type */
+#ifdef INP4CF_USE_FLOAT32_POS
+    typedef float t_inp4cf_pos;
+#   define INP4CF_FLOOR floorf
+#   define INP4CF_CEIL  ceilf
+#else
+    typedef double t_inp4cf_pos;
+#   define INP4CF_FLOOR floor
+#   define INP4CF_CEIL  ceil
+#endif // INP4CF_USE_FLOAT32_POS
+
+/* floor to int, also for the negative positions within the context */
+#define INP4CF_FLOOR_INT(x) ((int)(x) - ((x) < (int)(x)))
+
+/* Same layout as float [2], C99 float _Complex and std::complex<float> */
+typedef struct {
+    float re;
+    float im;
+} t_inp4cf_src;
+
+typedef t_inp4cf_src t_inp4cf_dst;
+
+
+typedef struct {
+    Inp4State state;                             /* both src and dst can't deplete on the same pass.
+                                                       src depletion takes priority */
+    int num_remaining;                              /* number of samples total to interpolate */
+    int dst_index;                                  /* dst output index, gets reset with every dst depletion */
+    int context_index;                              /* index of the next free slot */
+    int context_position;                           /* position of the first context element */
+    t_inp4cf_pos position;                         /* local position, gets reset with every src depletion */
+    t_inp4cf_src context [INP4CF_CTX_SIZE];   /* overlap context memory of complex taps */
+} inp4cf;
+
+
+static void inp4cf_init(inp4cf* interp, int num_to_write, t_inp4cf_src initial_state)
+{
+    interp->state = Inp4State_Init;
+    interp->num_remaining = num_to_write;
+    interp->dst_index = 0;
+    interp->context_index = 1;
+    interp->context_position = -1;
+    interp->position = 0.0;
+    interp->context[0] = initial_state;
+}
+
+static inp4cf inp4cf_create(int num_to_write, t_inp4cf_src initial_state)
+{
+    inp4cf interp;
+    inp4cf_init(&interp, num_to_write, initial_state);
+    return interp;
+}
+
+
+static t_inp4cf_dst  inp4cf__cubic_interp       (const t_inp4cf_src* x, t_inp4cf_pos fract);
+static void          inp4cf__push_to_context    (inp4cf* interp, const t_inp4cf_src* src, int nsrc);
+static int           inp4cf__read_from_src      (inp4cf* interp, t_inp4cf_dst* dst, const t_inp4cf_src* src, int nsrc, t_inp4cf_pos rate, int n);
+static void          inp4cf__post_process       (inp4cf* interp, const t_inp4cf_src* src, int nsrc);
+static void          inp4cf__copy_from_src     (t_inp4cf_dst* dst, const t_inp4cf_src* src, int step, int n);
+static int           inp4cf__num_within         (const inp4cf* interp, t_inp4cf_pos rate, int nsrc, int n);
+
+#ifdef INP4CF_USE_AVX2
+static __m256        inp4cf__cubic_eval_avx2    (__m256 x0, __m256 x1, __m256 x2, __m256 x3, __m256 fract);
+static int           inp4cf__read_from_src_avx2 (t_inp4cf_dst** dst, const t_inp4cf_src* src, t_inp4cf_pos* pos, t_inp4cf_pos rate, int n);
+#endif
+
+static void inp4cf_process(inp4cf* interp, t_inp4cf_dst* dst, int ndst, const t_inp4cf_src* src, int nsrc, t_inp4cf_pos rate)
+{
+    int n;
+
+    /* If we're not continuing with the same src */
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4cf__push_to_context(interp, src, nsrc);
+    }
+
+    /* Clear out old state flags */
+    interp->state = Inp4State_Done;
+
+    /* n is how many samples we may at most write to dst */
+    n = ndst - interp->dst_index;
+
+    if (n < interp->num_remaining) {
+
+        /* dst is shorter than the number of requested samples */
+        interp->state = Inp4State_DstDepleted;
+    } else {
+
+        /* dst is equal or too long, truncate */
+        n = interp->num_remaining;
+    }
+
+    /* the context as a window of src positions, see inp4ff_process */
+    n = inp4cf__read_from_src(interp, dst, interp->context - interp->context_position,
+                              interp->context_position + interp->context_index, rate, n);
+
+    if (n > 0 && nsrc > 3) {
+        n = inp4cf__read_from_src(interp, dst, src, nsrc, rate, n);
+    }
+
+    if (n > 0) {
+
+        /* src got depleted with this call */
+        interp->state = Inp4State_SrcDepleted;
+    }
+
+    inp4cf__post_process(interp, src, nsrc);
+}
+
+
+static t_inp4cf_dst inp4cf__cubic_interp(const t_inp4cf_src* x, t_inp4cf_pos fract)
+{
+    t_inp4cf_dst value;
+    const float f = (float)fract;
+    const float k = 0.1666667f * (1.0f - f);
+
+    const float re21_diff = x[2].re - x[1].re;
+    const float im21_diff = x[2].im - x[1].im;
+
+    const float re_c = (x[3].re - x[0].re - 3.0f * re21_diff) * f + (x[3].re + 2.0f * x[0].re - 3.0f * x[1].re);
+    const float im_c = (x[3].im - x[0].im - 3.0f * im21_diff) * f + (x[3].im + 2.0f * x[0].im - 3.0f * x[1].im);
+
+    value.re = x[1].re + f * (re21_diff - k * re_c);
+    value.im = x[1].im + f * (im21_diff - k * im_c);
+
+    return value;
+}
+
+static void inp4cf__push_to_context(inp4cf* interp, const t_inp4cf_src* src, int nsrc)
+{
+    int i, j, m;
+
+    /* We're either starting up or continuing with a new block. Copy
+        newly available samples to the end of the context buffer. */
+    m = nsrc < 3 ? nsrc : 3;
+
+    for (i = 0; i < m; ++i) {
+
+        /* If we're about to overflow, shift tail to the start of
+            the context. This is a fairly unlikely case. */
+        if (interp->context_index == INP4CF_CTX_SIZE) {
+
+            for (j = 0; j < 5; ++j) {
+                interp->context[j] = interp->context[interp->context_index - 5 + j];
+            }
+            interp->context_index = 5;
+            interp->context_position += INP4CF_CTX_SIZE - 5;
+        }
+
+        interp->context[interp->context_index++] = src[i];
+    }
+}
+
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4cf__copy_from_src(t_inp4cf_dst* dst, const t_inp4cf_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1) {
+        memcpy(dst, src, n * sizeof(t_inp4cf_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = src[i * step];
+    }
+}
+
+/* Number of the n outputs from the current position whose taps lie within
+   src, rounded up. See inp4ff__num_within. */
+static int inp4cf__num_within(const inp4cf* interp, t_inp4cf_pos rate, int nsrc, int n)
+{
+    t_inp4cf_pos m;
+
+    if (rate <= 0) return 0;
+
+    m = ((t_inp4cf_pos)(nsrc - 2) - interp->position) / rate;
+
+    if (m <= 0) return 0;
+    if (m >= n) return n;
+
+    return (int)m + ((int)m < m);
+}
+
+/* Interpolates up to n outputs from src while all four taps of the output lie
+   within src, see inp4ff__read_from_src. Returns the number of outputs left. */
+static int inp4cf__read_from_src(inp4cf* interp, t_inp4cf_dst* dst, const t_inp4cf_src* src, int nsrc, t_inp4cf_pos rate, int n)
+{
+    int num_read = n; /* init to n, substract after loop*/
+    const int maxpos = nsrc - 3;
+    t_inp4cf_pos pos = interp->position;
+
+    /* temps */
+    int ipos, step, m, nfast;
+    t_inp4cf_pos fract;
+
+    /* the outputs up to the estimate are read without checking the index */
+    nfast = nsrc > 3 ? inp4cf__num_within(interp, rate, nsrc, n) - 1 : 0;
+
+    /* truncation floors the positions only from zero up */
+    if (pos < 0) nfast = 0;
+
+    dst = dst + interp->dst_index;
+
+    /* At a whole position and a whole rate every output is a src sample */
+    if (rate == (int)rate && pos == (int)pos) {
+
+        ipos = (int)pos;
+        step = (int)rate;
+
+        if (ipos <= maxpos) {
+
+            m = step > 0 ? (maxpos - ipos) / step + 1 : n;
+            if (m > n) m = n;
+
+            inp4cf__copy_from_src(dst, &src[ipos], step, m);
+            dst += m;
+            pos += m * rate;
+            n -= m;
+            nfast -= m;
+        }
+    }
+
+    if (nfast > n) nfast = n;
+
+#ifdef INP4CF_USE_AVX2
+    if (nfast >= 4) {
+        m = inp4cf__read_from_src_avx2(&dst, src, &pos, rate, nfast);
+        n -= nfast - m;
+        nfast = m;
+    }
+#endif
+
+    while (nfast > 0) {
+
+        ipos = (int)(pos);
+        fract = pos - ipos;
+
+        *dst++ = inp4cf__cubic_interp(&src[ipos - 1], fract);
+
+        pos += rate;
+        n--;
+        nfast--;
+    }
+
+    /* the last outputs one by one up to the end of src */
+    while (n > 0) {
+
+        ipos = INP4CF_FLOOR_INT(pos);
+        fract = pos - ipos;
+
+        if (ipos > maxpos) break;
+
+        *dst++ = inp4cf__cubic_interp(&src[ipos - 1], fract);
+
+        pos += rate;
+        n--;
+    }
+
+    num_read -= n;
+
+    /* store */
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+static void inp4cf__post_process(inp4cf* interp, const t_inp4cf_src* src, int nsrc)
+{
+    int j;
+
+    if (interp->state == Inp4State_SrcDepleted) {
+
+        interp->position -= nsrc;
+
+        /* Fill the context by copying the 2 last and by reading 3 new elements
+           to the beginning of the context. If nsrc is not greater than we've
+           already pushed all available samples before the interpolation. */
+        if (nsrc > 3) {
+
+            interp->context[0] = interp->context[interp->context_index - 2];
+            interp->context[1] = interp->context[interp->context_index - 1];
+
+            for (j = 0; j < 3; ++j) {
+                interp->context[2 + j] = src[nsrc - 3 + j];
+            }
+
+            interp->context_index = 5;
+            interp->context_position = -5;
+
+        } else {
+            interp->context_position -= nsrc;
+        }
+    }
+    else if (interp->state == Inp4State_DstDepleted)
+    {
+        interp->dst_index = 0;
+    }
+}
+
+#ifdef INP4CF_USE_AVX2
+
+/* The cubic of inp4ff__cubic_eval_avx2, here on the re and im parts of four
+   outputs */
+static __m256 inp4cf__cubic_eval_avx2(__m256 x0, __m256 x1, __m256 x2, __m256 x3, __m256 fract)
+{
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 x21_diff = _mm256_sub_ps(x2, x1);
+
+    const __m256 c = _mm256_fmadd_ps(_mm256_fnmadd_ps(three, x21_diff, _mm256_sub_ps(x3, x0)), fract,
+                                     _mm256_fnmadd_ps(three, x1, _mm256_fmadd_ps(_mm256_set1_ps(2.0f), x0, x3)));
+
+    const __m256 k = _mm256_mul_ps(_mm256_set1_ps(0.1666667f), _mm256_sub_ps(_mm256_set1_ps(1.0f), fract));
+
+    return _mm256_fmadd_ps(fract, _mm256_fnmadd_ps(k, c, x21_diff), x1);
+}
+
+/* Outputs a, b, c and d at a time. The taps of an output are two pairs of
+   complex samples, one 128-bit load each. Unpacking 64-bit elements turns the
+   loads of a and c, and of b and d into one tap of all four, in output order,
+   so the result is stored as is. Returns the number of outputs left. */
+static int inp4cf__read_from_src_avx2(t_inp4cf_dst** dst, const t_inp4cf_src* src, t_inp4cf_pos* pos, t_inp4cf_pos rate, int n)
+{
+    t_inp4cf_pos p = *pos;
+    t_inp4cf_dst* out = *dst;
+    int ia, ib, ic, id;
+    float fa, fb, fc, fd;
+    __m256d ac01, bd01, ac23, bd23;
+    __m256 y;
+
+    for (; n >= 4; n -= 4, out += 4) {
+
+        ia = (int)p; fa = (float)(p - ia); p += rate;
+        ib = (int)p; fb = (float)(p - ib); p += rate;
+        ic = (int)p; fc = (float)(p - ic); p += rate;
+        id = (int)p; fd = (float)(p - id); p += rate;
+
+        ac01 = _mm256_castps_pd(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[ia - 1].re)),
+                                                     _mm_loadu_ps(&src[ic - 1].re), 1));
+        bd01 = _mm256_castps_pd(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[ib - 1].re)),
+                                                     _mm_loadu_ps(&src[id - 1].re), 1));
+        ac23 = _mm256_castps_pd(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[ia + 1].re)),
+                                                     _mm_loadu_ps(&src[ic + 1].re), 1));
+        bd23 = _mm256_castps_pd(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[ib + 1].re)),
+                                                     _mm_loadu_ps(&src[id + 1].re), 1));
+
+        y = inp4cf__cubic_eval_avx2(_mm256_castpd_ps(_mm256_unpacklo_pd(ac01, bd01)),
+                                    _mm256_castpd_ps(_mm256_unpackhi_pd(ac01, bd01)),
+                                    _mm256_castpd_ps(_mm256_unpacklo_pd(ac23, bd23)),
+                                    _mm256_castpd_ps(_mm256_unpackhi_pd(ac23, bd23)),
+                                    _mm256_setr_ps(fa, fa, fb, fb, fc, fc, fd, fd));
+
+        _mm256_storeu_ps(&out->re, y);
+    }
+
+    *pos = p;
+    *dst = out;
+
+    return n;
+}
+
+#endif // INP4CF_USE_AVX2
+
+
+#endif /* INP4CF_H */
@@ -32,6 +32,7 @@ DEALINGS IN THE SOFTWARE.
 #define INP4DF_H
 
 #include <math.h>
+#include <string.h>
 
 #ifndef INP4_STATE_ENUM
 #define INP4_STATE_ENUM
@@ -61,6 +62,13 @@ typedef enum {
 typedef float t_inp4df_src;
 typedef float t_inp4df_dst;
 
+/* With INP4DF_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. */
+#ifdef INP4DF_USE_LUT
+#   include "inp4lut.h"
+#endif // INP4DF_USE_LUT
+
 
 typedef struct {
     Inp4State state;                             /* both src and dst can't deplete on the same pass.
@@ -82,6 +90,9 @@ static void inp4df_init(inp4df* interp, int num_to_write, t_inp4df_src initial_s
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4DF_USE_LUT
+    inp4_lut_init();
+#endif
     interp->context[0] = initial_state;
 }
 
@@ -98,6 +109,7 @@ static int           inp4df__push_to_context    (inp4df* interp, const t_inp4df_
 static int           inp4df__read_from_context  (inp4df* interp, t_inp4df_dst* dst, t_inp4df_pos rate, int n);
 static void          inp4df__read_from_src      (inp4df* interp, t_inp4df_dst* dst, const t_inp4df_src* src, t_inp4df_pos rate, int n);
 static void          inp4df__post_process       (inp4df* interp, const t_inp4df_src* src, int nsrc);
+static void          inp4df__copy_from_src     (t_inp4df_dst* dst, const t_inp4df_src* src, int step, int n);
 
 static void inp4df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate)
 {
@@ -152,6 +164,14 @@ static void inp4df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_
 
 static t_inp4df_dst inp4df__cubic_interp(const t_inp4df_src* x, t_inp4df_pos fract)
 {
+#ifdef INP4DF_USE_LUT
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4df_pos)(0.5)) * 4];
+
+    return (t_inp4df_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
     const t_inp4df_dst x21_didf = x[2] - x[1];
     const t_inp4df_dst c = (x[3] - x[0] - (t_inp4df_dst)(3.0) * x21_didf) * fract
                            + (x[3] + (t_inp4df_dst)(2.0) * x[0] - (t_inp4df_dst)(3.0) * x[1]);
@@ -163,6 +183,8 @@ static t_inp4df_dst inp4df__cubic_interp(const t_inp4df_src* x, t_inp4df_pos fra
      */
 
     return value;
+
+#endif
 }
 
 static int inp4df__push_to_context(inp4df* interp, const t_inp4df_src* src, int nsrc)
@@ -224,6 +246,21 @@ static int inp4df__read_from_context(inp4df* interp, t_inp4df_dst* dst, t_inp4df
     return n;
 }
 
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4df__copy_from_src(t_inp4df_dst* dst, const t_inp4df_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4df_src) == sizeof(t_inp4df_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4df_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4df_dst)src[i * step];
+    }
+}
+
 static void inp4df__read_from_src(inp4df* interp, t_inp4df_dst* dst, const t_inp4df_src* src, t_inp4df_pos rate, int n)
 {
     int num_read = n; /* init to n, substract after loop*/
@@ -235,6 +272,13 @@ static void inp4df__read_from_src(inp4df* interp, t_inp4df_dst* dst, const t_inp
 
     dst = dst + interp->dst_index;
 
+    /* At a whole position and a whole rate every output is a src sample */
+    if (pos == INP4DF_FLOOR(pos) && rate == INP4DF_FLOOR(rate) && n > 0) {
+        inp4df__copy_from_src(dst, &src[(int)pos], (int)rate, n);
+        pos += n * rate;
+        n = 0;
+    }
+
     while (n > 0) {
 
         ipos = (int)(pos);
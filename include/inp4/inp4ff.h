@@ -32,6 +32,12 @@ DEALINGS IN THE SOFTWARE.
 #define INP4FF_H
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(INP4FF_USE_AVX2) || defined(INP4FF_USE_AVX512)
+#   include <immintrin.h>
+#endif
 
 #ifndef INP4_STATE_ENUM
 #define INP4_STATE_ENUM
@@ -58,9 +64,114 @@ typedef enum {
 #   define INP4FF_CEIL  ceil 
 #endif // INP4FF_USE_FLOAT32_POS
 
+/* floor to int, also for the negative positions within the context */
+#define INP4FF_FLOOR_INT(x) ((int)(x) - ((x) < (int)(x)))
+
 typedef float t_inp4ff_src;
 typedef float t_inp4ff_dst;
 
+/* With INP4FF_USE_FIXED_POS the position and the rate are held internally as
+   32.32 fixed point. The integer part of a position is then a shift and the
+   fraction a mask, and the positions are exact and independent of how src and
+   dst are segmented. The rate given to inp4ff_process gets rounded to the
+   nearest 2^-32. */
+#ifdef INP4FF_USE_FIXED_POS
+#   ifdef _MSC_VER
+        typedef __int64 t_inp4ff_phase;
+#   else
+        typedef long long t_inp4ff_phase;
+#   endif
+#   define INP4FF_PHASE_ONE         ((t_inp4ff_phase)1 << 32)
+#   define INP4FF_PHASE_MASK        (INP4FF_PHASE_ONE - 1)
+#   define INP4FF_PHASE_SCALE       4294967296.0
+
+    /* Fraction of a fixed point position. The lowest bit is dropped so that
+       the fraction converts as a signed 32-bit integer like in the vector
+       kernels. */
+#   define INP4FF_PHASE_FRACT(pos)  ((t_inp4ff_pos)(int)(((pos) & INP4FF_PHASE_MASK) >> 1) * (t_inp4ff_pos)(2.0 / INP4FF_PHASE_SCALE))
+#else
+    typedef t_inp4ff_pos t_inp4ff_phase;
+#   define INP4FF_PHASE_ONE         ((t_inp4ff_phase)1.0)
+#endif // INP4FF_USE_FIXED_POS
+
+/* With INP4FF_USE_INDEXED_POS the position of the output k since init is
+   computed as k * rate + base instead of by adding rate to the position on
+   every output. base is an integer that only changes when src gets depleted,
+   so the outputs are independent from each other, and identical however src
+   and dst are segmented as long as the rate stays the same. When the rate
+   changes, base is re-anchored to the whole part of the position and k
+   restarts from its fraction, see inp4ff__anchor. The precision of the
+   fraction is that of k * rate, i.e. 2^-20 after 2^32 outputs at rate 1. */
+#ifdef INP4FF_USE_INDEXED_POS
+#   if defined(INP4FF_USE_FLOAT32_POS) || defined(INP4FF_USE_FIXED_POS)
+#       error "INP4FF_USE_INDEXED_POS requires double positions"
+#   endif
+#endif // INP4FF_USE_INDEXED_POS
+
+/* With INP4FF_USE_COEFFS and rate at most 0.5, every source interval is
+   converted to the coefficients of its cubic once, and the outputs falling on
+   it are evaluated with Horner's scheme. The coefficients of the latest
+   intervals are kept in a ring in the state, so that they carry over from one
+   call to the next. Above 0.5 the intervals aren't reused often enough to pay
+   for the coefficients. */
+#ifdef INP4FF_USE_COEFFS
+#   ifndef INP4FF_COEFF_RING_SIZE
+#       define INP4FF_COEFF_RING_SIZE 4
+#   endif
+#   if INP4FF_COEFF_RING_SIZE < 2 || (INP4FF_COEFF_RING_SIZE & (INP4FF_COEFF_RING_SIZE - 1))
+#       error "INP4FF_COEFF_RING_SIZE must be a power of two and at least 2"
+#   endif
+#   define INP4FF_COEFF_MAX_RATE    (INP4FF_PHASE_ONE / 2)
+#endif // INP4FF_USE_COEFFS
+
+/* With INP4FF_USE_LUT the fraction is rounded to one of INP4_LUT_PHASES
+   phases, whose tap weights are read from the table shared with the other
+   variants, see inp4lut.h. The cubic becomes a dot product, at the cost of the
+   quantization error reported by inp4_lut_error_db. The vector kernels aren't
+   used in this mode. */
+#ifdef INP4FF_USE_LUT
+#   ifdef INP4FF_USE_COEFFS
+#       error "INP4FF_USE_LUT and INP4FF_USE_COEFFS are exclusive"
+#   endif
+#   include "inp4lut.h"
+#endif // INP4FF_USE_LUT
+
+#if (defined(INP4FF_USE_AVX2) || defined(INP4FF_USE_AVX512)) && !defined(INP4FF_USE_LUT)
+#   define INP4FF__USE_VECTOR
+#endif
+
+/* the batch kernel steps double positions of 8 lanes at a time */
+#if defined(INP4FF_USE_AVX2) && !defined(INP4FF_USE_LUT) && !defined(INP4FF_USE_FIXED_POS) \
+    && !defined(INP4FF_USE_INDEXED_POS) && !defined(INP4FF_USE_FLOAT32_POS)
+#   define INP4FF__USE_BATCH_VECTOR
+#endif
+
+/* One period of an exact rational rate, see inp4ff_ratio_init. The table can
+   be shared by any number of states converting with the same ratio. */
+#ifndef INP4FF_RATIO_MAX_PERIOD
+#   define INP4FF_RATIO_MAX_PERIOD 2048
+#endif
+
+typedef struct {
+    int up;                                         /* outputs per period, reduced */
+    int down;                                       /* src samples per period, reduced */
+    int advance [INP4FF_RATIO_MAX_PERIOD];          /* integer step after each output of the period */
+    t_inp4ff_dst weights [INP4FF_RATIO_MAX_PERIOD][4];     /* tap weights of each output of the period */
+} inp4ff_ratio;
+
+/* Output stage of inp4ff_process_mix and inp4ff_process_stereo. Output j gets
+   (gain + j * gain_step) * pan[c] times its value on channel c, added to dst
+   when accumulating. j counts from the dst passed to the process function. */
+typedef struct {
+    int num_channels;                               /* 1 or 2, 0 stores the outputs as they are */
+    int accumulate;                                 /* add to dst instead of overwriting it */
+    t_inp4ff_dst gain;                              /* gain of output 0 */
+    t_inp4ff_dst gain_step;                         /* change of the gain per output */
+    t_inp4ff_dst pan [2];                           /* weight of each channel */
+    const t_inp4ff_dst* dst;                        /* output 0 of the first channel */
+    t_inp4ff_dst* right;                            /* output 0 of the second channel */
+} inp4ff_output;
+
 
 typedef struct {
     Inp4State state;                             /* both src and dst can't deplete on the same pass.
@@ -69,19 +180,189 @@ typedef struct {
     int dst_index;                                  /* dst output index, gets reset with every dst depletion */
     int context_index;                              /* index of the next free slot */
     int context_position;                           /* position of the first context element */
-    t_inp4ff_pos position;                         /* local position, gets reset with every src depletion */
+    t_inp4ff_phase position;                       /* local position, gets reset with every src depletion */
+#ifdef INP4FF_USE_INDEXED_POS
+    t_inp4ff_pos count;                             /* number of outputs since the rate was set */
+    t_inp4ff_pos base;                              /* integer offset from count * rate to the local position */
+    t_inp4ff_pos rate;                              /* rate count and base are anchored to */
+#endif
+#ifdef INP4FF_USE_COEFFS
+    unsigned int num_consumed;                      /* src samples consumed since init, wraps around */
+    unsigned int coeff_tags [INP4FF_COEFF_RING_SIZE];       /* absolute interval of each slot */
+    t_inp4ff_pos coeffs [INP4FF_COEFF_RING_SIZE][4];       /* cubic coefficients, constant term first */
+#endif
+    const inp4ff_ratio* ratio;                      /* table of inp4ff_process_ratio, or 0 */
+    int ratio_phase;                                /* output index within the period of ratio */
+    int reverse;                                    /* src is read from its end to its start, see inp4ff_process */
     t_inp4ff_src context [INP4FF_CTX_SIZE];   /* overlap context memory */
 } inp4ff;
 
+/* State of a multichannel stream. The position and the flags are shared by
+   all channels, and each channel has its own context. */
+#ifndef INP4FF_MAX_CHANNELS
+#   define INP4FF_MAX_CHANNELS 8
+#endif
+
+/* Number of positions computed at a time for all planar channels */
+#ifndef INP4FF_BLOCK_SIZE
+#   define INP4FF_BLOCK_SIZE 64
+#endif
+
+/* Number of outputs staged on the stack for the output stage of
+   inp4ff_process_mix and inp4ff_process_stereo */
+#ifndef INP4FF_STAGE_SIZE
+#   define INP4FF_STAGE_SIZE 256
+#endif
+
+typedef struct {
+    inp4ff interp;                                  /* shared state, its context goes unused */
+    t_inp4ff_src context [INP4FF_CTX_SIZE * INP4FF_MAX_CHANNELS];     /* overlap context memory, interleaved */
+} inp4ff_multi;
+
+/* State of INP4FF_BATCH_LANES independent voices, one per lane of the vector
+   kernels, stored as arrays of the fields of inp4ff. The fields read on every
+   output come first. */
+#ifndef INP4FF_BATCH_LANES
+#   define INP4FF_BATCH_LANES 8
+#endif
+
+typedef struct {
+    t_inp4ff_phase position [INP4FF_BATCH_LANES];
+    t_inp4ff_phase rate [INP4FF_BATCH_LANES];      /* rate of the latest call, count and base are anchored to it */
+    int num_remaining [INP4FF_BATCH_LANES];
+    int dst_index [INP4FF_BATCH_LANES];
+#ifdef INP4FF_USE_INDEXED_POS
+    t_inp4ff_pos count [INP4FF_BATCH_LANES];
+    t_inp4ff_pos base [INP4FF_BATCH_LANES];
+#endif
+    Inp4State state [INP4FF_BATCH_LANES];
+    int context_index [INP4FF_BATCH_LANES];
+    int context_position [INP4FF_BATCH_LANES];
+    t_inp4ff_src context [INP4FF_BATCH_LANES][INP4FF_CTX_SIZE];
+} inp4ff_batch;
+
+/* Pool of states for many voices, see inp4ff_pool_init. Each state takes
+   whole cache lines of its own, so workers on different voices never share
+   a line. The fields used on every output lead the state and share its first
+   line, the context and the ratio follow. The free list and the bits of the
+   active voices are kept apart from the states. The states aren't split into
+   separate hot and cold arrays, inp4ff_process works on a whole inp4ff. A
+   default state takes two lines, so 10k voices take about 1.25 MB, more than
+   the L2 cache of most cores. */
+#ifndef INP4FF_CACHE_LINE
+#   define INP4FF_CACHE_LINE 64
+#endif
+
+typedef union {
+    inp4ff interp;
+    char lines [(sizeof(inp4ff) + INP4FF_CACHE_LINE - 1) / INP4FF_CACHE_LINE * INP4FF_CACHE_LINE];
+} inp4ff_slot;
+
+typedef struct {
+    volatile unsigned long long free_head;          /* tag << 32 | first free slot + 1, the tag counts pops */
+    int capacity;
+    inp4ff_slot* slots;                             /* line aligned within memory */
+    volatile int* next_free;                        /* next free slot of each free slot, or -1 */
+    volatile unsigned int* active;                  /* a bit for each acquired slot */
+    void* memory;
+} inp4ff_pool;
+
+/* Atomics of the pool. The head of the free list is loaded as a whole, a
+   plain load of 64 bits may tear on 32-bit targets. The links of the free
+   list are read by acquire while release writes them, they only need to be
+   atomic, the exchange of the head orders them. */
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#   define INP4FF__LOAD64(p)            ((unsigned long long)_InterlockedCompareExchange64((volatile __int64*)(p), 0, 0))
+#   define INP4FF__LOAD32(p)            ((int)_InterlockedCompareExchange((volatile long*)(p), 0, 0))
+#   define INP4FF__STORE32(p, v)        _InterlockedExchange((volatile long*)(p), (long)(v))
+#   define INP4FF__CAS64(p, old, new)   (_InterlockedCompareExchange64((volatile __int64*)(p), (new), (old)) == (old))
+#   define INP4FF__OR32(p, v)           _InterlockedOr((volatile long*)(p), (long)(v))
+#   define INP4FF__AND32(p, v)          _InterlockedAnd((volatile long*)(p), (long)(v))
+#elif defined(__GNUC__)
+#   define INP4FF__LOAD64(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#   define INP4FF__LOAD32(p)            __atomic_load_n((p), __ATOMIC_RELAXED)
+#   define INP4FF__STORE32(p, v)        __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#   define INP4FF__CAS64(p, old, new)   __sync_bool_compare_and_swap((p), (old), (new))
+#   define INP4FF__OR32(p, v)           __sync_fetch_and_or((p), (v))
+#   define INP4FF__AND32(p, v)          __sync_fetch_and_and((p), (v))
+#else
+#   error "inp4ff_pool needs atomics, none are known for this compiler"
+#endif
+
+/* One call of inp4ff_process, for the scheduler of inp4ff_process_voices */
+typedef struct {
+    inp4ff* interp;
+    t_inp4ff_dst* dst;
+    int ndst;
+    const t_inp4ff_src* src;
+    int nsrc;
+    t_inp4ff_pos rate;
+} inp4ff_voice;
+
+/* Most cache lines of src fetched ahead for a voice */
+#ifndef INP4FF_PREFETCH_LINES
+#   define INP4FF_PREFETCH_LINES 8
+#endif
+
+/* Cache lines of src after which inp4ff_process_voices closes a group */
+#ifndef INP4FF_GROUP_LINES
+#   define INP4FF_GROUP_LINES 64
+#endif
+
+#if defined(__GNUC__)
+#   define INP4FF__PREFETCH(p)          __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <xmmintrin.h>
+#   define INP4FF__PREFETCH(p)          _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#   define INP4FF__PREFETCH(p)          ((void)(p))
+#endif
+
+/* Circular delay line of a power of two samples, see inp4ff_delay_init. The
+   first INP4FF_DELAY_GUARD samples of the buffer are repeated past its end,
+   so the four taps of a read are always consecutive in memory. */
+#define INP4FF_DELAY_GUARD 3
+
+typedef struct {
+    t_inp4ff_src* data;                             /* size + INP4FF_DELAY_GUARD samples */
+    unsigned int mask;                              /* size - 1 */
+    unsigned int write_index;                       /* samples written since init, wraps around */
+} inp4ff_delay;
 
 static void inp4ff_init(inp4ff* interp, int num_to_write, t_inp4ff_src initial_state)
 {
+    int i;
+
     interp->state = Inp4State_Init;
     interp->num_remaining = num_to_write;
     interp->dst_index = 0;
     interp->context_index = 1;
     interp->context_position = -1;
     interp->position = 0.0;
+#ifdef INP4FF_USE_INDEXED_POS
+    interp->count = 0.0;
+    interp->base = 0.0;
+    interp->rate = 0.0;
+#endif
+#ifdef INP4FF_USE_COEFFS
+    interp->num_consumed = 0;
+    /* a tag that doesn't map to its own slot never matches */
+    for (i = 0; i < INP4FF_COEFF_RING_SIZE; ++i) {
+        interp->coeff_tags[i] = i + 1;
+    }
+#endif
+#ifdef INP4FF_USE_LUT
+    inp4_lut_init();
+#endif
+    interp->ratio = 0;
+    interp->ratio_phase = 0;
+    interp->reverse = 0;
+    /* only the first element is read before being written, the rest are
+       cleared so that copies of a created state are fully defined */
+    for (i = 1; i < INP4FF_CTX_SIZE; ++i) {
+        interp->context[i] = 0;
+    }
     interp->context[0] = initial_state;
 }
 
@@ -92,198 +373,3285 @@ static inp4ff inp4ff_create(int num_to_write, t_inp4ff_pos initial_state)
     return interp;
 }
 
+/* State for inp4ff_process_ratio, converting with the ratio of an initialised
+   table. The table has to outlive the state. */
+static inp4ff inp4ff_create_ratio(int num_to_write, t_inp4ff_pos initial_state, const inp4ff_ratio* ratio)
+{
+    inp4ff interp;
+    inp4ff_init(&interp, num_to_write, initial_state);
+    interp.ratio = ratio;
+    return interp;
+}
+
+static void inp4ff_multi_init(inp4ff_multi* interp, int num_to_write, t_inp4ff_src initial_state)
+{
+    int c;
 
-static t_inp4ff_dst  inp4ff__cubic_interp       (const t_inp4ff_src* x, t_inp4ff_pos fract);
-static int           inp4ff__push_to_context    (inp4ff* interp, const t_inp4ff_src* src, int nsrc);
-static int           inp4ff__read_from_context  (inp4ff* interp, t_inp4ff_dst* dst, t_inp4ff_pos rate, int n);
-static void          inp4ff__read_from_src      (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, t_inp4ff_pos rate, int n);
-static void          inp4ff__post_process       (inp4ff* interp, const t_inp4ff_src* src, int nsrc);
+    inp4ff_init(&interp->interp, num_to_write, initial_state);
 
-static void inp4ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+    for (c = 0; c < INP4FF_MAX_CHANNELS; ++c) {
+        interp->context[c] = initial_state;
+    }
+}
+
+static inp4ff_multi inp4ff_multi_create(int num_to_write, t_inp4ff_pos initial_state)
 {
-    int n, last_index;
+    inp4ff_multi interp;
+    inp4ff_multi_init(&interp, num_to_write, initial_state);
+    return interp;
+}
 
-    /* If we're not continuing with the same src */
-    if (interp->state != Inp4State_DstDepleted) {
-        inp4ff__push_to_context(interp, src, nsrc);
+/* inp4ff_init for one lane of a batch. Once a lane is done it is left alone by
+   inp4ff_process_batch until started again, its src and dst aren't read. */
+static void inp4ff_batch_start(inp4ff_batch* batch, int lane, int num_to_write, t_inp4ff_src initial_state)
+{
+    batch->state[lane] = Inp4State_Init;
+    batch->num_remaining[lane] = num_to_write;
+    batch->dst_index[lane] = 0;
+    batch->context_index[lane] = 1;
+    batch->context_position[lane] = -1;
+    batch->position[lane] = 0.0;
+    batch->rate[lane] = 0.0;
+#ifdef INP4FF_USE_INDEXED_POS
+    batch->count[lane] = 0.0;
+    batch->base[lane] = 0.0;
+#endif
+#ifdef INP4FF_USE_LUT
+    inp4_lut_init();
+#endif
+    batch->context[lane][0] = initial_state;
+}
+
+static void inp4ff_batch_init(inp4ff_batch* batch)
+{
+    int l;
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+        inp4ff_batch_start(batch, l, 0, 0);
     }
-    
-    /* Clear out old state flags */
-    interp->state = Inp4State_Done;
-    
-    /* n is how many samples we may at most write to dst */
-    n = ndst - interp->dst_index;
-    
-    if (n < interp->num_remaining) {
+}
 
-        /* dst is shorter than the number of requested samples */
-        interp->state = Inp4State_DstDepleted;
-    } else {
+/* Allocates a pool of capacity states, all of them free. Returns capacity, or
+   0 if the allocation failed. */
+static int inp4ff_pool_init(inp4ff_pool* pool, int capacity)
+{
+    int i;
+    const int num_words = (capacity + 31) / 32;
 
-        /* dst is equal or too long, truncate */
-        n = interp->num_remaining;
+    pool->capacity = capacity;
+    pool->free_head = capacity > 0 ? 1 : 0;
+    pool->memory = malloc(sizeof(inp4ff_slot) * capacity + INP4FF_CACHE_LINE);
+    pool->next_free = (volatile int*)malloc(sizeof(int) * capacity);
+    pool->active = (volatile unsigned int*)malloc(sizeof(unsigned int) * num_words);
+
+    if (!pool->memory || !pool->next_free || !pool->active) {
+        free(pool->memory); free((void*)pool->next_free); free((void*)pool->active);
+        pool->memory = 0; pool->next_free = 0; pool->active = 0;
+        return 0;
     }
-    
-    n = inp4ff__read_from_context(interp, dst, rate, n);
-    
-    /* Reading from context may have depleted all available space in dst. */
-    if (n > 0) {
-        
-        /* Check if we will overflow, i.e. if src doesn't have enough samples
-           available. */
-        last_index = (int)(interp->position + n * rate);
-        
-        if (last_index > nsrc - 3) {
-            
-            /* src is going to get depleted with this call */
-            interp->state = Inp4State_SrcDepleted;
-            
-            /* Adjust how many samples we're still able to write */
-            n = (int)INP4FF_CEIL(((t_inp4ff_pos)(nsrc - 2) - interp->position) / rate);
-        }
-        
-        /* do the main interpolation loop */
-        inp4ff__read_from_src(interp, dst, src, rate, n);
+
+    pool->slots = (inp4ff_slot*)(((size_t)pool->memory + INP4FF_CACHE_LINE - 1) & ~(size_t)(INP4FF_CACHE_LINE - 1));
+
+    for (i = 0; i < capacity; ++i) {
+        pool->next_free[i] = i + 1 < capacity ? i + 1 : -1;
     }
-    
-    inp4ff__post_process(interp, src, nsrc);
+    for (i = 0; i < num_words; ++i) {
+        pool->active[i] = 0;
+    }
+
+    return capacity;
 }
 
+static void inp4ff_pool_free(inp4ff_pool* pool)
+{
+    free(pool->memory);
+    free((void*)pool->next_free);
+    free((void*)pool->active);
+    pool->memory = 0;
+    pool->next_free = 0;
+    pool->active = 0;
+}
 
-static t_inp4ff_dst inp4ff__cubic_interp(const t_inp4ff_src* x, t_inp4ff_pos fract)
+/* Takes a free state off the pool and initialises it as inp4ff_init would.
+   Returns 0 if every state is in use. Safe to call from several threads. */
+static inp4ff* inp4ff_pool_acquire(inp4ff_pool* pool, int num_to_write, t_inp4ff_src initial_state)
 {
-    const t_inp4ff_dst x21_diff = x[2] - x[1];
-    const t_inp4ff_dst c = (x[3] - x[0] - (t_inp4ff_dst)(3.0) * x21_diff) * fract
-                           + (x[3] + (t_inp4ff_dst)(2.0) * x[0] - (t_inp4ff_dst)(3.0) * x[1]);
-    
-    const t_inp4ff_dst value = x[1] + fract * (x21_diff - (t_inp4ff_dst)(0.1666667) * ((t_inp4ff_dst)(1.0) - fract) * c);
-    
-    /*
-    printf("%i: [%.20f, %.20f, %.20f, %.20f] (fract: %.20f) -> %.20f\n", interp_counter++, x[0], x[1], x[2], x[3], fract, value);
-     */
+    unsigned long long head, next;
+    int index;
 
-    return value;
+    do {
+        head = INP4FF__LOAD64(&pool->free_head);
+        index = (int)(head & 0xffffffff) - 1;
+
+        if (index < 0) return 0;
+
+        /* a newer tag fails the exchange if the slot was taken meanwhile */
+        next = ((head >> 32) + 1) << 32 | (unsigned int)(INP4FF__LOAD32(&pool->next_free[index]) + 1);
+
+    } while (!INP4FF__CAS64(&pool->free_head, head, next));
+
+    INP4FF__OR32(&pool->active[index / 32], 1u << (index % 32));
+
+    inp4ff_init(&pool->slots[index].interp, num_to_write, initial_state);
+
+    return &pool->slots[index].interp;
 }
 
-static int inp4ff__push_to_context(inp4ff* interp, const t_inp4ff_src* src, int nsrc)
+/* Returns a state to the pool. Safe to call from several threads. */
+static void inp4ff_pool_release(inp4ff_pool* pool, inp4ff* interp)
 {
-    int i, j, m;
+    unsigned long long head, next;
+    const int index = (int)((inp4ff_slot*)interp - pool->slots);
 
-    /* We're either starting up or continuing with a new block. Copy
-        newly available samples to the end of the context buffer. */
-    m = nsrc < 3 ? nsrc : 3;
-    
-    for (i = 0; i < m; ++i) {
+    INP4FF__AND32(&pool->active[index / 32], ~(1u << (index % 32)));
 
-        /* If we're about to overflow, shift tail to the start of
-            the context. This is a fairly unlikely case. */
-        if (interp->context_index == INP4FF_CTX_SIZE) {
+    do {
+        head = INP4FF__LOAD64(&pool->free_head);
+        INP4FF__STORE32(&pool->next_free[index], (int)(head & 0xffffffff) - 1);
+        next = (head >> 32 << 32) | (unsigned int)(index + 1);
 
-            for (j = 0; j < 5; ++j) {
-                interp->context[j] = interp->context[interp->context_index - 5 + j];
-            }
-            interp->context_index = 5;
-            interp->context_position += INP4FF_CTX_SIZE - 5;
-        }
-            
-        interp->context[interp->context_index++] = src[i];
-    }
+    } while (!INP4FF__CAS64(&pool->free_head, head, next));
 }
-    
-static int inp4ff__read_from_context(inp4ff* interp, t_inp4ff_dst* dst, t_inp4ff_pos rate, int n)
+
+/* Index of the first acquired state after index, or -1. Start from -1.
+   Workers can split the pool into ranges of indices. */
+static int inp4ff_pool_next(const inp4ff_pool* pool, int index)
 {
-    int num_read = n; /* init to n, substract after loop */
+    unsigned int bits;
+    int word;
 
-    int ipos, index;
-    t_inp4ff_pos fract, pos;
-    const int maxpos = interp->context_position + interp->context_index - 3;
+    if (++index >= pool->capacity) return -1;
 
-    pos = interp->position;
-    dst = dst + interp->dst_index; /* dst is incremented as ptr */
+    word = index / 32;
+    bits = pool->active[word] & (~0u << (index % 32));
 
-    ipos = (int)(INP4FF_FLOOR(interp->position));
-    
-    while (ipos <= maxpos && n > 0)
-    {
-        index = ipos - interp->context_position - 1;
-        fract = pos - ipos;
-        
-        *dst++ = inp4ff__cubic_interp(&interp->context[index], fract);
-        
-        pos += rate;
-        n--;
-        ipos = (int)(INP4FF_FLOOR(pos));
+    while (!bits) {
+        if (++word >= (pool->capacity + 31) / 32) return -1;
+        bits = pool->active[word];
     }
-    num_read = num_read - n;
 
-    /* store */
-    interp->position = pos;
-    interp->num_remaining -= num_read;
-    interp->dst_index += num_read;
+    index = word * 32;
+    while (!(bits & 1u)) {
+        bits >>= 1;
+        index++;
+    }
 
-    return n;
+    return index < pool->capacity ? index : -1;
 }
 
-static void inp4ff__read_from_src(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, t_inp4ff_pos rate, int n)
+static inp4ff* inp4ff_pool_at(inp4ff_pool* pool, int index)
 {
-    int num_read = n; /* init to n, substract after loop*/
-    t_inp4ff_pos pos = interp->position;
+    return &pool->slots[index].interp;
+}
 
-    /* temps */
-    int ipos, index;
-    t_inp4ff_pos fract;
+/* Allocates a delay line of at least size samples, rounded up to a power of
+   two, holding silence. Returns the size, or 0 if the allocation failed. */
+static int inp4ff_delay_init(inp4ff_delay* delay, int size)
+{
+    unsigned int n = 4;
 
-    dst = dst + interp->dst_index;
+    while (n < (unsigned int)size) n <<= 1;
 
-    while (n > 0) {
+    delay->mask = n - 1;
+    delay->write_index = 0;
+    delay->data = (t_inp4ff_src*)calloc(n + INP4FF_DELAY_GUARD, sizeof(t_inp4ff_src));
 
-        ipos = (int)(pos);
-        index = ipos - 1;
-        fract = pos - ipos;
-        
-        *dst++ = inp4ff__cubic_interp(&src[index], fract);
-        
-        pos += rate;
-        n--;
+    return delay->data ? (int)n : 0;
+}
+
+static void inp4ff_delay_free(inp4ff_delay* delay)
+{
+    free(delay->data);
+    delay->data = 0;
+}
+
+
+static t_inp4ff_dst  inp4ff__cubic_interp       (const t_inp4ff_src* x, t_inp4ff_pos fract);
+static void          inp4ff__push_to_context    (inp4ff* interp, const t_inp4ff_src* src, int nsrc, int stride);
+static void          inp4ff__push_frames        (inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* src, int nsrc, int nch);
+static void          inp4ff__push_planar        (inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* const* src, int nsrc, int nch);
+static t_inp4ff_src* inp4ff__context_slot       (inp4ff* interp, t_inp4ff_src* context, int nch);
+static int           inp4ff__read_from_src      (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int n);
+static void          inp4ff__post_process       (inp4ff* interp, const t_inp4ff_src* src, int nsrc, int stride);
+static void          inp4ff__post_process_frames(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* src, int nsrc, int nch);
+static void          inp4ff__post_process_planar(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* const* src, int nsrc, int nch);
+static int           inp4ff__advance_src        (inp4ff* interp, t_inp4ff_src* context, int nsrc, int nch);
+static int           inp4ff__read_frames        (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, int nch, t_inp4ff_phase rate, int n);
+static void          inp4ff__cubic_interp_frame (const t_inp4ff_src* x, int nch, t_inp4ff_pos fract, t_inp4ff_dst* dst);
+static int           inp4ff__read_planar        (inp4ff* interp, t_inp4ff_dst* const* dst, int dst_step, const t_inp4ff_src* const* src, int step, int nsrc, int nch, t_inp4ff_phase rate, int n);
+static void          inp4ff__cubic_interp_block (const t_inp4ff_src* src, int step, const int* index, const t_inp4ff_pos* fract, int m, t_inp4ff_dst* dst, int dst_step);
+static void          inp4ff__copy_from_src     (t_inp4ff_dst* dst, const t_inp4ff_src* src, int step, int n);
+static void          inp4ff__process            (inp4ff* interp, const inp4ff_output* out, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate);
+static int           inp4ff__read               (inp4ff* interp, const inp4ff_output* out, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int reverse, int n);
+static void          inp4ff__output_block       (const inp4ff_output* out, t_inp4ff_dst* dst, int j, const t_inp4ff_dst* y, int n);
+static const t_inp4ff_src* inp4ff__voice_address(const inp4ff_voice* voice);
+static int           inp4ff__voice_lines        (const inp4ff_voice* voice);
+static int           inp4ff__voice_group        (const inp4ff_voice* voices, const int* order, int i, int num_voices, size_t* begin, size_t* end);
+static t_inp4ff_phase inp4ff__phase_rate      (t_inp4ff_pos rate);
+static void          inp4ff__batch_push         (inp4ff_batch* batch, int lane, const t_inp4ff_src* src, int nsrc);
+static void          inp4ff__batch_post_process (inp4ff_batch* batch, int lane, const t_inp4ff_src* src, int nsrc);
+#ifdef INP4FF__USE_BATCH_VECTOR
+static void          inp4ff__cubic_eval_lanes   (t_inp4ff_src x [4][INP4FF_BATCH_LANES], const t_inp4ff_pos* fract, t_inp4ff_dst* y);
+#else
+static int           inp4ff__read_lane          (const inp4ff_batch* batch, int lane, t_inp4ff_dst** out, const t_inp4ff_src* window, const t_inp4ff_src* src,
+                                                 int max_context, int max_src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n);
+#endif
+static int           inp4ff__read_ratio         (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, int n);
+static int           inp4ff__read_reverse       (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int n);
+static void          inp4ff__turn               (inp4ff* interp, const t_inp4ff_src* src, int nsrc, int reverse);
+#ifndef INP4FF_USE_INDEXED_POS
+static int           inp4ff__read_varirate      (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, const t_inp4ff_pos* rates, int n);
+static int           inp4ff__read_ramp          (inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, t_inp4ff_phase step, int n);
+static t_inp4ff_phase inp4ff__ramp_step         (t_inp4ff_phase rate_start, t_inp4ff_phase rate_end, int ndst);
+static t_inp4ff_phase inp4ff__ramp_at           (t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int m);
+static int           inp4ff__ramp_within        (t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int nsrc, int n);
+#endif
+static void          inp4ff__weights            (t_inp4ff_pos fract, t_inp4ff_src* w);
+static void          inp4ff__fir4               (const t_inp4ff_src* x, const t_inp4ff_src* w, t_inp4ff_dst* dst, int n);
+
+static int           inp4ff__num_within         (const inp4ff* interp, t_inp4ff_phase rate, int nsrc, int n);
+
+#ifdef INP4FF_USE_INDEXED_POS
+static t_inp4ff_pos  inp4ff__index_at           (const inp4ff* interp, t_inp4ff_pos rate, t_inp4ff_pos count, int* ipos);
+static t_inp4ff_pos  inp4ff__index_of           (t_inp4ff_pos count, t_inp4ff_pos base, t_inp4ff_pos rate, int* ipos);
+static void          inp4ff__anchor             (inp4ff* interp, t_inp4ff_pos rate);
+#endif
+
+#ifdef INP4FF_USE_COEFFS
+static t_inp4ff_dst  inp4ff__cubic_interp_coeffs(inp4ff* interp, const t_inp4ff_src* x, int ipos, t_inp4ff_pos fract);
+#endif
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+static __m256        inp4ff__cubic_eval_avx2            (__m256 x0, __m256 x1, __m256 x2, __m256 x3, __m256 fract);
+static __m128        inp4ff__cubic_eval_sse             (__m128 x0, __m128 x1, __m128 x2, __m128 x3, __m128 fract);
+static __m256        inp4ff__cubic_interp_avx2          (const t_inp4ff_src* src, __m256i index, __m256 fract);
+static __m256        inp4ff__cubic_interp_permute_avx2  (const t_inp4ff_src* window, __m256i offset, __m256 fract);
+static int           inp4ff__read_from_src_avx2         (const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n);
+static int           inp4ff__read_from_src_upsample_avx2(const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n);
+static int           inp4ff__read_frames_avx2           (const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, int nch, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n);
+static int           inp4ff__delay_read_avx2            (const t_inp4ff_src* data, unsigned int mask, unsigned int base, t_inp4ff_dst* dst, const t_inp4ff_pos* delays, int n);
+#   ifndef INP4FF_USE_INDEXED_POS
+static int           inp4ff__read_varirate_avx2         (t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase* pos, const t_inp4ff_pos** rates, int n);
+#       ifndef INP4FF_USE_FLOAT32_POS
+static int           inp4ff__read_ramp_avx2             (t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int n);
+#       endif
+#   endif
+#endif
+
+#ifdef INP4FF__USE_BATCH_VECTOR
+static void          inp4ff__read_lanes_avx2            (const t_inp4ff_src* const* src, const int* active, t_inp4ff_phase* pos, const t_inp4ff_phase* rate, t_inp4ff_dst** out, int m);
+#endif
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX512)
+static __m512        inp4ff__cubic_interp_avx512    (const t_inp4ff_src* src, __m512i index, __m512 fract);
+static int           inp4ff__read_from_src_avx512   (const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n);
+#endif
+
+/* With a negative rate src is read from its end to its start, and the next
+   src is the one before it in memory. The context then holds the samples
+   following src, in the order they were read, and the positions count from
+   the end of src. The sign may change between calls, on the src of the
+   latest call, or on the one it ran out of, see inp4ff__turn. */
+static void inp4ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+{
+    inp4ff__process(interp, 0, dst, ndst, src, nsrc, rate);
+}
+
+/* inp4ff_process adding gain times the outputs to dst instead of storing them,
+   to mix a voice straight into a bus without a scratch buffer */
+static void inp4ff_process_mix(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate, t_inp4ff_dst gain)
+{
+    inp4ff_output out;
+
+    out.num_channels = 1;
+    out.accumulate = 1;
+    out.gain = gain;
+    out.gain_step = (t_inp4ff_dst)(0.0);
+    out.pan[0] = out.pan[1] = (t_inp4ff_dst)(1.0);
+    out.right = 0;
+
+    inp4ff__process(interp, &out, dst, ndst, src, nsrc, rate);
+}
+
+/* inp4ff_process panned into a stereo pair, written or added to left and
+   right. The gain ramps linearly from gain_start at left[0] towards gain_end
+   at left[ndst], so the ramps of consecutive dst join up. */
+static void inp4ff_process_stereo(inp4ff* interp, t_inp4ff_dst* left, t_inp4ff_dst* right, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate,
+                                  t_inp4ff_dst gain_start, t_inp4ff_dst gain_end, t_inp4ff_dst pan_left, t_inp4ff_dst pan_right, int accumulate)
+{
+    inp4ff_output out;
+
+    out.num_channels = 2;
+    out.accumulate = accumulate;
+    out.gain = gain_start;
+    out.gain_step = ndst > 0 ? (gain_end - gain_start) / ndst : (t_inp4ff_dst)(0.0);
+    out.pan[0] = pan_left;
+    out.pan[1] = pan_right;
+    out.right = right;
+
+    inp4ff__process(interp, &out, left, ndst, src, nsrc, rate);
+}
+
+/* Precomputes one period of the rate down / up, i.e. up outputs for every
+   down src samples, such as 160 / 147 for 44100 Hz to 48000 Hz. The sequence
+   of integer steps and fractions repeats after up outputs once the ratio is
+   reduced, so the positions stay exact however long the stream runs. Returns
+   the period, or 0 if it doesn't fit in INP4FF_RATIO_MAX_PERIOD. */
+static int inp4ff_ratio_init(inp4ff_ratio* ratio, int up, int down)
+{
+    int i, j, a = up, b = down, t;
+    t_inp4ff_src x [4];
+
+    /* reduce with the greatest common divisor */
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
     }
     
-    num_read -= n;
+    if (up <= 0 || down <= 0 || up / a > INP4FF_RATIO_MAX_PERIOD) return 0;
 
-    /* store */
-    interp->position = pos;
-    interp->dst_index += num_read;
-    interp->num_remaining -= num_read;
+#ifdef INP4FF_USE_LUT
+    inp4_lut_init();
+#endif
+
+    ratio->up = up / a;
+    ratio->down = down / a;
+
+    for (i = 0; i < ratio->up; ++i) {
+
+        ratio->advance[i] = (int)(((long long)(i + 1) * ratio->down) / ratio->up
+                                  - ((long long)i * ratio->down) / ratio->up);
+
+        /* the cubic is linear in the taps, each weight is the response to a
+           unit tap */
+        for (j = 0; j < 4; ++j) {
+            x[0] = x[1] = x[2] = x[3] = (t_inp4ff_src)(0.0);
+            x[j] = (t_inp4ff_src)(1.0);
+            ratio->weights[i][j] = inp4ff__cubic_interp(x, (t_inp4ff_pos)(((long long)i * ratio->down) % ratio->up) / ratio->up);
+        }
+    }
+
+    return ratio->up;
 }
 
-static void inp4ff__post_process(inp4ff* interp, const t_inp4ff_src* src, int nsrc)
+/* inp4ff_process for a state from inp4ff_create_ratio. The positions are
+   stepped through the period table of the ratio instead of adding a rate. */
+static void inp4ff_process_ratio(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc)
 {
-    if (interp->state == Inp4State_SrcDepleted) {
+    int n;
 
-        interp->position -= nsrc;
-        
-        /* Fill the context by copying the 2 last and by reading 3 new elements
-           to the beginning of the context. If nsrc is not greater than we've
-           already pushed all available samples before the interpolation. */
-        if (nsrc > 3) {
+    /* a state left reversed by inp4ff_process reads forward from here on */
+    inp4ff__turn(interp, src, nsrc, 0);
 
-            interp->context[0] = interp->context[interp->context_index - 2];
-            interp->context[1] = interp->context[interp->context_index - 1];
-            interp->context[2] = src[nsrc - 3];
-            interp->context[3] = src[nsrc - 2];
-            interp->context[4] = src[nsrc - 1];
-            
-            interp->context_index = 5;
-            interp->context_position = -5;
-            
-        } else {
-            interp->context_position -= nsrc;
-        }
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4ff__push_to_context(interp, src, nsrc, 1);
     }
-    else if (interp->state == Inp4State_DstDepleted)
-    {
-        interp->dst_index = 0;
+    
+    interp->state = Inp4State_Done;
+    
+    n = ndst - interp->dst_index;
+    
+    if (n < interp->num_remaining) {
+        interp->state = Inp4State_DstDepleted;
+    } else {
+        n = interp->num_remaining;
     }
+
+    /* the context as a window of src positions, see inp4ff_process */
+    n = inp4ff__read_ratio(interp, dst, interp->context - interp->context_position,
+                           interp->context_position + interp->context_index, n);
+    
+    if (n > 0 && nsrc > 3) {
+        n = inp4ff__read_ratio(interp, dst, src, nsrc, n);
+    }
+
+    if (n > 0) {
+        interp->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process(interp, src, nsrc, 1);
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+/* inp4ff_process with a rate for every output, for vibrato and pitch bends.
+   rates runs parallel to dst, rates[i] being the step from dst[i] to the next
+   output. Where src runs out is found while the positions are stepped, so
+   the rates are read once. The positions only move forward, a negative rate
+   is taken as 0. An indexed position follows a single rate, so there's no
+   varirate with INP4FF_USE_INDEXED_POS. */
+static void inp4ff_process_varirate(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, const t_inp4ff_pos* rates)
+{
+    int n;
+
+    /* a state left reversed by inp4ff_process reads forward from here on */
+    inp4ff__turn(interp, src, nsrc, 0);
+
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4ff__push_to_context(interp, src, nsrc, 1);
+    }
+    
+    interp->state = Inp4State_Done;
+    
+    n = ndst - interp->dst_index;
+    
+    if (n < interp->num_remaining) {
+        interp->state = Inp4State_DstDepleted;
+    } else {
+        n = interp->num_remaining;
+    }
+
+    /* the context as a window of src positions, see inp4ff_process */
+    n = inp4ff__read_varirate(interp, dst, interp->context - interp->context_position,
+                              interp->context_position + interp->context_index, rates, n);
+    
+    if (n > 0 && nsrc > 3) {
+        n = inp4ff__read_varirate(interp, dst, src, nsrc, rates, n);
+    }
+
+    if (n > 0) {
+        interp->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process(interp, src, nsrc, 1);
+}
+#endif
+
+#ifndef INP4FF_USE_INDEXED_POS
+/* inp4ff_process with the rate gliding linearly from rate_start at dst[0]
+   towards rate_end at dst[ndst], so the glides of consecutive dst join up.
+   The positions are quadratic in the output, and the output where src runs
+   out is found in closed form. The positions only move forward, a negative
+   rate is taken as 0. With INP4FF_USE_FIXED_POS the change of the rate per
+   output is rounded to 2^-32, so the rate reached at dst[ndst] may miss
+   rate_end by ndst * 2^-33. Not available with INP4FF_USE_INDEXED_POS. */
+static void inp4ff_process_ramp(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate_start, t_inp4ff_pos rate_end)
+{
+    int n;
+    const t_inp4ff_phase rate = inp4ff__phase_rate(rate_start > 0 ? rate_start : (t_inp4ff_pos)(0.0));
+    const t_inp4ff_phase step = inp4ff__ramp_step(rate, inp4ff__phase_rate(rate_end > 0 ? rate_end : (t_inp4ff_pos)(0.0)), ndst);
+
+    /* a state left reversed by inp4ff_process reads forward from here on */
+    inp4ff__turn(interp, src, nsrc, 0);
+
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4ff__push_to_context(interp, src, nsrc, 1);
+    }
+    
+    interp->state = Inp4State_Done;
+    
+    n = ndst - interp->dst_index;
+    
+    if (n < interp->num_remaining) {
+        interp->state = Inp4State_DstDepleted;
+    } else {
+        n = interp->num_remaining;
+    }
+
+    /* the context as a window of src positions, see inp4ff_process */
+    n = inp4ff__read_ramp(interp, dst, interp->context - interp->context_position,
+                          interp->context_position + interp->context_index, rate, step, n);
+    
+    if (n > 0 && nsrc > 3) {
+        n = inp4ff__read_ramp(interp, dst, src, nsrc, rate, step, n);
+    }
+
+    if (n > 0) {
+        interp->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process(interp, src, nsrc, 1);
+}
+#endif
+
+/* Appends n samples to the delay line. Of more than its size only the last
+   ones are kept. */
+static void inp4ff_delay_write(inp4ff_delay* delay, const t_inp4ff_src* src, int n)
+{
+    const int size = (int)delay->mask + 1;
+    int start, m;
+
+    if (n > size) {
+        delay->write_index += n - size;
+        src += n - size;
+        n = size;
+    }
+
+    start = (int)(delay->write_index & delay->mask);
+    m = size - start < n ? size - start : n;
+
+    memcpy(delay->data + start, src, sizeof(t_inp4ff_src) * m);
+    memcpy(delay->data, src + m, sizeof(t_inp4ff_src) * (n - m));
+
+    /* the guard follows the start of the buffer */
+    memcpy(delay->data + size, delay->data, sizeof(t_inp4ff_src) * INP4FF_DELAY_GUARD);
+
+    delay->write_index += n;
+}
+
+/* Reads n outputs from the delay line, dst[i] delays[i] samples behind the
+   i-th of the last n samples written. The delays go from 2, the taps ahead of
+   the position, up to the size less n + 1, and aren't checked. */
+static void inp4ff_delay_read(const inp4ff_delay* delay, t_inp4ff_dst* dst, int n, const t_inp4ff_pos* delays)
+{
+    const t_inp4ff_src* data = delay->data;
+    const unsigned int mask = delay->mask;
+    const unsigned int base = delay->write_index - (unsigned int)n - 1;   /* x0 of an output i - delay = 0 */
+    int i = 0, k;
+    int index [8];
+    t_inp4ff_pos fract [8];
+
+    /* temps */
+    t_inp4ff_pos t;
+    int it;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    i = inp4ff__delay_read_avx2(data, mask, base, dst, delays, n);
+    dst += i;
+#endif
+
+    /* the taps of a group are found ahead of its cubics, as in inp4ff__read_ramp */
+    for (; i < n; i += 8, dst += 8) {
+
+        for (k = 0; k < 8 && i + k < n; ++k) {
+            t = (t_inp4ff_pos)(i + k) - delays[i + k];
+            it = INP4FF_FLOOR_INT(t);
+            index[k] = (int)((base + (unsigned int)it) & mask);
+            fract[k] = t - it;
+        }
+
+        while (k-- > 0) {
+            dst[k] = inp4ff__cubic_interp(data + index[k], fract[k]);
+        }
+    }
+}
+
+/* Reads n outputs for each of num_taps taps of the delay line into dst[j],
+   delays[j] samples behind the last n samples written as in
+   inp4ff_delay_read. The delay of a tap holds for the block, so its fraction
+   does too: the cubic turns into 4 weights found once, and a tap into a
+   filter over the consecutive samples it passes. The taps are read one after
+   the other, each over the few cache lines of its stretch, and the vector
+   lanes go over the outputs of a tap rather than across taps: those load
+   consecutive samples, where lanes across taps would need a gather per
+   weight and a transpose to store. */
+static void inp4ff_delay_read_taps(const inp4ff_delay* delay, t_inp4ff_dst* const* dst, int n, const t_inp4ff_pos* delays, int num_taps)
+{
+    const int size = (int)delay->mask + 1;
+    const unsigned int base = delay->write_index - (unsigned int)n - 1;
+    int j, start, m;
+    t_inp4ff_src w [4];
+
+    /* temps */
+    t_inp4ff_pos t;
+    int it;
+
+    for (j = 0; j < num_taps; ++j) {
+
+        t = -delays[j];
+        it = INP4FF_FLOOR_INT(t);
+
+        inp4ff__weights(t - it, w);
+
+        /* x0 of the first output, and the outputs up to the end of the buffer,
+           the guard covers the taps past it */
+        start = (int)((base + (unsigned int)it) & delay->mask);
+        m = size - start < n ? size - start : n;
+
+        inp4ff__fir4(delay->data + start, w, dst[j], m);
+        inp4ff__fir4(delay->data, w, dst[j] + m, n - m);
+    }
+}
+
+/* inp4ff_process for nch interleaved channels, at most INP4FF_MAX_CHANNELS.
+   ndst and nsrc count frames. The index and the fraction of each output
+   are computed once for all of its channels. */
+static void inp4ff_process_interleaved(inp4ff_multi* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, int nch, t_inp4ff_pos rate)
+{
+    int n;
+    inp4ff* st = &interp->interp;
+    const t_inp4ff_phase phase_rate = inp4ff__phase_rate(rate);
+
+#ifdef INP4FF_USE_INDEXED_POS
+    inp4ff__anchor(st, phase_rate);
+#endif
+
+    if (st->state != Inp4State_DstDepleted) {
+        inp4ff__push_frames(st, interp->context, src, nsrc, nch);
+    }
+    
+    st->state = Inp4State_Done;
+    
+    n = ndst - st->dst_index;
+    
+    if (n < st->num_remaining) {
+        st->state = Inp4State_DstDepleted;
+    } else {
+        n = st->num_remaining;
+    }
+
+    /* a single channel takes the faster paths of inp4ff_process */
+    if (nch == 1) {
+        n = inp4ff__read_from_src(st, dst, interp->context - st->context_position,
+                                  st->context_position + st->context_index, phase_rate, n);
+        if (n > 0 && nsrc > 3) {
+            n = inp4ff__read_from_src(st, dst, src, nsrc, phase_rate, n);
+        }
+    } else {
+        /* the context as a window of src positions, see inp4ff_process */
+        n = inp4ff__read_frames(st, dst, interp->context - st->context_position * nch,
+                                st->context_position + st->context_index, nch, phase_rate, n);
+        if (n > 0 && nsrc > 3) {
+            n = inp4ff__read_frames(st, dst, src, nsrc, nch, phase_rate, n);
+        }
+    }
+
+    if (n > 0) {
+        st->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process_frames(st, interp->context, src, nsrc, nch);
+}
+
+/* inp4ff_process_interleaved for nch channels in separate arrays, src[c] and
+   dst[c] being channel c. The positions are computed a block at a time and
+   the block is then interpolated channel by channel. */
+static void inp4ff_process_planar(inp4ff_multi* interp, t_inp4ff_dst* const* dst, int ndst, const t_inp4ff_src* const* src, int nsrc, int nch, t_inp4ff_pos rate)
+{
+    int n, c;
+    inp4ff* st = &interp->interp;
+    const t_inp4ff_src* window [INP4FF_MAX_CHANNELS];
+    const t_inp4ff_phase phase_rate = inp4ff__phase_rate(rate);
+
+#ifdef INP4FF_USE_INDEXED_POS
+    inp4ff__anchor(st, phase_rate);
+#endif
+
+    if (st->state != Inp4State_DstDepleted) {
+        inp4ff__push_planar(st, interp->context, src, nsrc, nch);
+    }
+    
+    st->state = Inp4State_Done;
+    
+    n = ndst - st->dst_index;
+    
+    if (n < st->num_remaining) {
+        st->state = Inp4State_DstDepleted;
+    } else {
+        n = st->num_remaining;
+    }
+
+    /* the context is interleaved, each channel is read from it nch apart */
+    for (c = 0; c < nch; ++c) {
+        window[c] = interp->context - st->context_position * nch + c;
+    }
+
+    n = inp4ff__read_planar(st, dst, 1, window, nch, st->context_position + st->context_index, nch, phase_rate, n);
+    
+    if (n > 0 && nsrc > 3) {
+        n = inp4ff__read_planar(st, dst, 1, src, 1, nsrc, nch, phase_rate, n);
+    }
+
+    if (n > 0) {
+        st->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process_planar(st, interp->context, src, nsrc, nch);
+}
+
+/* inp4ff_process reading src_stride and writing dst_stride samples apart, such
+   as one channel straight out of and into interleaved buffers. ndst and nsrc
+   count the samples of the channel. */
+static void inp4ff_process_strided(inp4ff* interp, t_inp4ff_dst* dst, int ndst, int dst_stride, const t_inp4ff_src* src, int nsrc, int src_stride, t_inp4ff_pos rate)
+{
+    int n;
+    const t_inp4ff_src* window;
+    const t_inp4ff_phase phase_rate = inp4ff__phase_rate(rate);
+
+    /* a state left reversed by inp4ff_process reads forward from here on */
+    inp4ff__turn(interp, src, nsrc, 0);
+
+#ifdef INP4FF_USE_INDEXED_POS
+    inp4ff__anchor(interp, phase_rate);
+#endif
+
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4ff__push_to_context(interp, src, nsrc, src_stride);
+    }
+    
+    interp->state = Inp4State_Done;
+    
+    n = ndst - interp->dst_index;
+    
+    if (n < interp->num_remaining) {
+        interp->state = Inp4State_DstDepleted;
+    } else {
+        n = interp->num_remaining;
+    }
+
+    /* the context as a window of src positions, see inp4ff_process */
+    window = interp->context - interp->context_position;
+
+    n = inp4ff__read_planar(interp, &dst, dst_stride, &window, 1,
+                            interp->context_position + interp->context_index, 1, phase_rate, n);
+    
+    if (n > 0 && nsrc > 3) {
+        n = inp4ff__read_planar(interp, &dst, dst_stride, &src, src_stride, nsrc, 1, phase_rate, n);
+    }
+
+    if (n > 0) {
+        interp->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process(interp, src, nsrc, src_stride);
+}
+
+/* inp4ff_process for every lane of a batch at once, lane l writing to dst[l]
+   from src[l] at rate[l] and ending up in batch->state[l] as a single state
+   would. With the AVX2 kernel the voices advance together one output per
+   step, and the cubic of a step is evaluated for all the lanes in one go,
+   otherwise the lanes are run one after the other. The batch keeps no
+   coefficients, so with INP4FF_USE_COEFFS a lane at a rate of at most 0.5
+   gets the plain cubic, which may differ from the Horner form of
+   inp4ff_process by a few ulp. */
+static void inp4ff_process_batch(inp4ff_batch* batch, t_inp4ff_dst* const* dst, const int* ndst,
+                                 const t_inp4ff_src* const* src, const int* nsrc, const t_inp4ff_pos* rate)
+{
+    int l;
+    int n [INP4FF_BATCH_LANES];                     /* outputs left */
+    int num_read [INP4FF_BATCH_LANES];
+    int depleted [INP4FF_BATCH_LANES];
+    int max_context [INP4FF_BATCH_LANES];           /* last index read from the context */
+    int max_src [INP4FF_BATCH_LANES];               /* last index read from src */
+    const t_inp4ff_src* window [INP4FF_BATCH_LANES];
+    t_inp4ff_dst* out [INP4FF_BATCH_LANES];         /* next output */
+
+    /* positions and rates are kept local over the loop, the stores to dst
+       could otherwise alias them */
+    t_inp4ff_phase pos [INP4FF_BATCH_LANES];
+    t_inp4ff_phase step [INP4FF_BATCH_LANES];
+
+#ifdef INP4FF__USE_BATCH_VECTOR
+    int ipos, num_active, m, k;
+    int active [INP4FF_BATCH_LANES];
+    const t_inp4ff_src* x;
+
+    /* taps and fraction of the current output of every lane */
+    t_inp4ff_src taps [4][INP4FF_BATCH_LANES];
+    t_inp4ff_pos fract [INP4FF_BATCH_LANES];
+    t_inp4ff_dst y [INP4FF_BATCH_LANES];
+#endif
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+#ifdef INP4FF_USE_INDEXED_POS
+        /* a lane changing its rate is re-anchored, see inp4ff__anchor */
+        if (inp4ff__phase_rate(rate[l]) != batch->rate[l]) {
+            batch->base[l] = INP4FF_FLOOR(batch->position[l]);
+            batch->count[l] = rate[l] > 0 ? (batch->position[l] - batch->base[l]) / rate[l] : 0.0;
+        }
+#endif
+        batch->rate[l] = inp4ff__phase_rate(rate[l]);
+
+        if (batch->state[l] == Inp4State_Done) {
+
+            /* finished voice, idle until started again */
+            n[l] = num_read[l] = depleted[l] = 0;
+            max_context[l] = max_src[l] = -1;
+            window[l] = 0;
+            out[l] = 0;
+            continue;
+        }
+
+        if (batch->state[l] != Inp4State_DstDepleted) {
+            inp4ff__batch_push(batch, l, src[l], nsrc[l]);
+        }
+
+        batch->state[l] = Inp4State_Done;
+
+        n[l] = ndst[l] - batch->dst_index[l];
+
+        if (n[l] < batch->num_remaining[l]) {
+            batch->state[l] = Inp4State_DstDepleted;
+        } else {
+            n[l] = batch->num_remaining[l];
+        }
+        num_read[l] = n[l];
+        depleted[l] = 0;
+
+        /* The context as a window of src positions, see inp4ff_process. The
+           positions only grow, so the lane reads src once past the window. */
+        window[l] = batch->context[l] - batch->context_position[l];
+        max_context[l] = batch->context_position[l] + batch->context_index[l] - 3;
+        max_src[l] = nsrc[l] > 3 ? nsrc[l] - 3 : max_context[l];
+        out[l] = dst[l] + batch->dst_index[l];
+    }
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+#ifdef INP4FF_USE_INDEXED_POS
+        pos[l] = batch->count[l];
+#else
+        pos[l] = batch->position[l];
+#endif
+        step[l] = batch->rate[l];
+    }
+
+#ifndef INP4FF__USE_BATCH_VECTOR
+    /* Without the vector kernel the lanes gain nothing from stepping
+       together, each one is run to its end in turn */
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+        if (n[l] <= 0) continue;
+
+        n[l] = inp4ff__read_lane(batch, l, &out[l], window[l], src[l], max_context[l], max_src[l], &pos[l], step[l], n[l]);
+
+        if (n[l] > 0) {
+            /* src depleted, the lane stops with n[l] left */
+            depleted[l] = 1;
+            num_read[l] -= n[l];
+        }
+    }
+#else
+    do {
+        /* Number of steps that every running lane takes within src, with a
+           step of margin for the rounding. The lanes still on the context
+           are stepped one by one below. */
+        m = 0x7fffffff;
+        num_active = 0;
+
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+            active[l] = n[l] > 0;
+            if (!active[l]) continue;
+
+            if (INP4FF_FLOOR_INT(pos[l]) <= max_context[l]) {
+                m = 0;
+                break;
+            }
+
+            k = step[l] > 0 ? (int)((max_src[l] + 1 - pos[l]) / step[l]) - 1 : n[l];
+            if (k > n[l]) k = n[l];
+            if (k < m) m = k;
+            num_active++;
+        }
+
+        if (num_active > 0 && m >= 4) {
+
+            for (l = 0; l + 8 <= INP4FF_BATCH_LANES; l += 8) {
+                inp4ff__read_lanes_avx2(&src[l], &active[l], &pos[l], &step[l], &out[l], m);
+            }
+            for (; l < INP4FF_BATCH_LANES; ++l) {
+                for (k = 0; k < m && active[l]; ++k) {
+                    ipos = (int)pos[l];
+                    *out[l]++ = inp4ff__cubic_interp(&src[l][ipos - 1], pos[l] - ipos);
+                    pos[l] += step[l];
+                }
+            }
+            for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+                if (active[l]) n[l] -= m;
+            }
+            continue;
+        }
+
+        num_active = 0;
+
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+            taps[0][l] = taps[1][l] = taps[2][l] = taps[3][l] = 0;
+            fract[l] = 0;
+
+            if (n[l] <= 0) continue;
+
+#if defined(INP4FF_USE_FIXED_POS)
+            ipos = (int)(pos[l] >> 32);
+            fract[l] = INP4FF_PHASE_FRACT(pos[l]);
+#elif defined(INP4FF_USE_INDEXED_POS)
+            fract[l] = inp4ff__index_of(pos[l], batch->base[l], step[l], &ipos);
+#else
+            ipos = INP4FF_FLOOR_INT(pos[l]);
+            fract[l] = pos[l] - ipos;
+#endif
+
+            if (ipos <= max_context[l]) {
+                x = &window[l][ipos - 1];
+            } else if (ipos <= max_src[l]) {
+                x = &src[l][ipos - 1];
+            } else {
+                /* src depleted, the lane stops with n[l] left */
+                depleted[l] = 1;
+                num_read[l] -= n[l];
+                n[l] = 0;
+                continue;
+            }
+
+            taps[0][l] = x[0];
+            taps[1][l] = x[1];
+            taps[2][l] = x[2];
+            taps[3][l] = x[3];
+            num_active++;
+        }
+
+        if (num_active == 0) break;
+
+        inp4ff__cubic_eval_lanes(taps, fract, y);
+
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+            if (n[l] <= 0) continue;
+
+            *out[l]++ = y[l];
+
+#ifdef INP4FF_USE_INDEXED_POS
+            pos[l] += 1.0;
+#else
+            pos[l] += step[l];
+#endif
+            n[l]--;
+        }
+
+    } while (1);
+#endif
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l) {
+
+        if (depleted[l]) {
+            batch->state[l] = Inp4State_SrcDepleted;
+        }
+        if (num_read[l] > 0) {
+            batch->dst_index[l] += num_read[l];
+            batch->num_remaining[l] -= num_read[l];
+        }
+#ifdef INP4FF_USE_INDEXED_POS
+        batch->count[l] = pos[l];
+        batch->position[l] = pos[l] * step[l] + batch->base[l];
+#else
+        batch->position[l] = pos[l];
+#endif
+
+        inp4ff__batch_post_process(batch, l, src[l], nsrc[l]);
+    }
+}
+
+/* Orders the voices of a block by the src address they read next, so that
+   voices on the same src at nearby positions are processed one after the
+   other. order holds indices to voices, kept from the previous block, and
+   0 to num_voices - 1 for the first one. The voices move little from block
+   to block, so the insertion sort is close to linear. */
+static void inp4ff_schedule(const inp4ff_voice* voices, int* order, int num_voices)
+{
+    int i, j, v;
+    size_t key;
+
+    /* addresses of different src only compare as integers */
+    for (i = 1; i < num_voices; ++i) {
+
+        v = order[i];
+        key = (size_t)inp4ff__voice_address(&voices[v]);
+
+        for (j = i; j > 0 && (size_t)inp4ff__voice_address(&voices[order[j - 1]]) > key; --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = v;
+    }
+}
+
+/* inp4ff_process for the voices in the order of inp4ff_schedule. Consecutive
+   voices reading overlapping lines of src form a group, and the lines of the
+   next group are fetched once, while the current group is processed. */
+static void inp4ff_process_voices(const inp4ff_voice* voices, const int* order, int num_voices)
+{
+    int i = 0, group_end, next_end;
+    const inp4ff_voice* voice;
+    size_t begin, end, line;
+
+    group_end = num_voices > 0 ? inp4ff__voice_group(voices, order, 0, num_voices, &begin, &end) : 0;
+
+    while (i < num_voices) {
+
+        next_end = group_end;
+
+        if (group_end < num_voices) {
+
+            next_end = inp4ff__voice_group(voices, order, group_end, num_voices, &begin, &end);
+
+            for (line = begin & ~(size_t)(INP4FF_CACHE_LINE - 1); line < end; line += INP4FF_CACHE_LINE) {
+                INP4FF__PREFETCH((const char*)line);
+            }
+        }
+
+        for (; i < group_end; ++i) {
+            voice = &voices[order[i]];
+            inp4ff_process(voice->interp, voice->dst, voice->ndst, voice->src, voice->nsrc, voice->rate);
+        }
+
+        group_end = next_end;
+    }
+}
+
+/* inp4ff_process for num_states states reading the same src at their own
+   rates, such as the layers of an octave stack or a detuned unison, state i
+   writing to dst[i] at rate[i]. Each state reads the whole of src in turn. A
+   pass over src shared by all the states, a tile at a time, measured no
+   faster, the reads of a state are already sequential and prefetched. */
+static void inp4ff_process_rates(inp4ff* const* interps, t_inp4ff_dst* const* dst, const int* ndst, int num_states,
+                                 const t_inp4ff_src* src, int nsrc, const t_inp4ff_pos* rate)
+{
+    int i;
+
+    for (i = 0; i < num_states; ++i) {
+        inp4ff_process(interps[i], dst[i], ndst[i], src, nsrc, rate[i]);
+    }
+}
+
+
+static t_inp4ff_dst inp4ff__cubic_interp(const t_inp4ff_src* x, t_inp4ff_pos fract)
+{
+#if defined(INP4FF_USE_LUT)
+
+    const float* w = &inp4_lut[(int)(fract * INP4_LUT_PHASES + (t_inp4ff_pos)(0.5)) * 4];
+
+    return (t_inp4ff_dst)(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3] * x[3]);
+
+#else
+
+    const t_inp4ff_dst x21_diff = x[2] - x[1];
+    const t_inp4ff_dst c = (x[3] - x[0] - (t_inp4ff_dst)(3.0) * x21_diff) * fract
+                           + (x[3] + (t_inp4ff_dst)(2.0) * x[0] - (t_inp4ff_dst)(3.0) * x[1]);
+    
+    const t_inp4ff_dst value = x[1] + fract * (x21_diff - (t_inp4ff_dst)(0.1666667) * ((t_inp4ff_dst)(1.0) - fract) * c);
+    
+    /*
+    printf("%i: [%.20f, %.20f, %.20f, %.20f] (fract: %.20f) -> %.20f\n", interp_counter++, x[0], x[1], x[2], x[3], fract, value);
+     */
+
+    return value;
+
+#endif
+}
+
+static void inp4ff__push_to_context(inp4ff* interp, const t_inp4ff_src* src, int nsrc, int stride)
+{
+    int i, m;
+
+    /* We're either starting up or continuing with a new block. Copy
+        newly available samples to the end of the context buffer. */
+    m = nsrc < 3 ? nsrc : 3;
+    
+    for (i = 0; i < m; ++i) {
+        *inp4ff__context_slot(interp, interp->context, 1) = src[i * stride];
+    }
+}
+
+static void inp4ff__push_frames(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* src, int nsrc, int nch)
+{
+    int i, j, m;
+    t_inp4ff_src* slot;
+
+    /* We're either starting up or continuing with a new block. Copy
+        newly available samples to the end of the context buffer. */
+    m = nsrc < 3 ? nsrc : 3;
+    
+    for (i = 0; i < m; ++i) {
+
+        slot = inp4ff__context_slot(interp, context, nch);
+            
+        for (j = 0; j < nch; ++j) {
+            slot[j] = src[i * nch + j];
+        }
+    }
+}
+
+static void inp4ff__push_planar(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* const* src, int nsrc, int nch)
+{
+    int i, c, m;
+    t_inp4ff_src* slot;
+
+    m = nsrc < 3 ? nsrc : 3;
+    
+    for (i = 0; i < m; ++i) {
+
+        slot = inp4ff__context_slot(interp, context, nch);
+            
+        for (c = 0; c < nch; ++c) {
+            slot[c] = src[c][i];
+        }
+    }
+}
+
+/* Returns the next frame of nch samples at the end of the context */
+static t_inp4ff_src* inp4ff__context_slot(inp4ff* interp, t_inp4ff_src* context, int nch)
+{
+    int j;
+
+    /* If we're about to overflow, shift tail to the start of
+        the context. This is a fairly unlikely case. */
+    if (interp->context_index == INP4FF_CTX_SIZE) {
+
+        for (j = 0; j < 5 * nch; ++j) {
+            context[j] = context[(interp->context_index - 5) * nch + j];
+        }
+        interp->context_index = 5;
+        interp->context_position += INP4FF_CTX_SIZE - 5;
+    }
+
+    return &context[interp->context_index++ * nch];
+}
+    
+/* inp4ff_process through the output stage out, or storing the outputs as they
+   are if out is 0 */
+static void inp4ff__process(inp4ff* interp, const inp4ff_output* out, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+{
+    int n;
+    const int reverse = rate < 0;
+
+    /* the reads are those of a src reversed, at the rate turned positive */
+    const t_inp4ff_phase phase_rate = inp4ff__phase_rate(reverse ? -rate : rate);
+
+    inp4ff__turn(interp, src, nsrc, reverse);
+
+#ifdef INP4FF_USE_INDEXED_POS
+    inp4ff__anchor(interp, phase_rate);
+#endif
+
+    /* If we're not continuing with the same src */
+    if (interp->state != Inp4State_DstDepleted) {
+        inp4ff__push_to_context(interp, reverse ? src + nsrc - 1 : src, nsrc, reverse ? -1 : 1);
+    }
+    
+    /* Clear out old state flags */
+    interp->state = Inp4State_Done;
+    
+    /* n is how many samples we may at most write to dst */
+    n = ndst - interp->dst_index;
+    
+    if (n < interp->num_remaining) {
+
+        /* dst is shorter than the number of requested samples */
+        interp->state = Inp4State_DstDepleted;
+    } else {
+
+        /* dst is equal or too long, truncate */
+        n = interp->num_remaining;
+    }
+    
+    /* The tail of the previous src and the first samples of this one are
+       staged contiguously in the context. It's read by the same loop as src,
+       as a window of src positions. */
+    n = inp4ff__read(interp, out, dst, interp->context - interp->context_position,
+                     interp->context_position + interp->context_index, phase_rate, 0, n);
+    
+    /* Reading from context may have depleted all available space in dst. A
+       src of at most 3 samples is in the context as a whole. */
+    if (n > 0 && nsrc > 3) {
+        
+        /* do the main interpolation loop, which stops where src runs out */
+        n = inp4ff__read(interp, out, dst, src, nsrc, phase_rate, reverse, n);
+    }
+
+    if (n > 0) {
+
+        /* src got depleted with this call */
+        interp->state = Inp4State_SrcDepleted;
+    }
+    
+    inp4ff__post_process(interp, reverse ? src + nsrc - 1 : src, nsrc, reverse ? -1 : 1);
+}
+
+/* inp4ff__read_from_src, or inp4ff__read_reverse if reverse, through the output
+   stage out unless it's 0. The outputs are staged in a block on the stack and
+   passed through the output stage from there, so the readers store as they
+   are. */
+static int inp4ff__read(inp4ff* interp, const inp4ff_output* out, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int reverse, int n)
+{
+    int m, num_read, dst_index;
+    t_inp4ff_dst block [INP4FF_STAGE_SIZE];
+
+    if (!out) {
+        return reverse ? inp4ff__read_reverse(interp, dst, src, nsrc, rate, n) : inp4ff__read_from_src(interp, dst, src, nsrc, rate, n);
+    }
+
+    while (n > 0) {
+
+        m = n < INP4FF_STAGE_SIZE ? n : INP4FF_STAGE_SIZE;
+
+        /* the readers write from dst_index on */
+        dst_index = interp->dst_index;
+        interp->dst_index = 0;
+
+        num_read = m - (reverse ? inp4ff__read_reverse(interp, block, src, nsrc, rate, m) : inp4ff__read_from_src(interp, block, src, nsrc, rate, m));
+
+        interp->dst_index += dst_index;
+        inp4ff__output_block(out, dst + dst_index, dst_index, block, num_read);
+
+        n -= num_read;
+        if (num_read < m) break;
+    }
+
+    return n;
+}
+
+/* Passes the n outputs in y through the output stage to dst, the first of
+   them being output j */
+static void inp4ff__output_block(const inp4ff_output* out, t_inp4ff_dst* dst, int j, const t_inp4ff_dst* y, int n)
+{
+    int i;
+    t_inp4ff_dst value;
+    t_inp4ff_dst* right;
+
+    /* copied, the stores to dst may alias them */
+    const t_inp4ff_dst gain = out->gain;
+    const t_inp4ff_dst gain_step = out->gain_step;
+    const t_inp4ff_dst pan_left = out->pan[0];
+    const t_inp4ff_dst pan_right = out->pan[1];
+
+    if (out->num_channels == 2) {
+
+        right = out->right + j;
+
+        if (out->accumulate) {
+            for (i = 0; i < n; ++i) {
+                value = (gain + (j + i) * gain_step) * y[i];
+                dst[i] += pan_left * value;
+                right[i] += pan_right * value;
+            }
+        } else {
+            for (i = 0; i < n; ++i) {
+                value = (gain + (j + i) * gain_step) * y[i];
+                dst[i] = pan_left * value;
+                right[i] = pan_right * value;
+            }
+        }
+    } else if (out->accumulate) {
+        for (i = 0; i < n; ++i) {
+            dst[i] += pan_left * ((gain + (j + i) * gain_step) * y[i]);
+        }
+    } else {
+        for (i = 0; i < n; ++i) {
+            dst[i] = pan_left * ((gain + (j + i) * gain_step) * y[i]);
+        }
+    }
+}
+
+/* Copies n src samples step apart, the output of the cubic at whole positions */
+static void inp4ff__copy_from_src(t_inp4ff_dst* dst, const t_inp4ff_src* src, int step, int n)
+{
+    int i;
+
+    if (step == 1 && sizeof(t_inp4ff_src) == sizeof(t_inp4ff_dst)) {
+        memcpy(dst, src, n * sizeof(t_inp4ff_dst));
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = (t_inp4ff_dst)src[i * step];
+    }
+}
+
+/* inp4ff__read_from_src for src read from its end, at positions counting
+   from there. The cubic is symmetric, so the output at position ipos + fract
+   of the reversed src is that of src at nsrc - 2 - ipos + (1 - fract), and
+   the taps are read from src as they are. */
+static int inp4ff__read_reverse(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int n)
+{
+    int num_read = n; /* init to n, substract after loop */
+    const int maxpos = nsrc - 3;
+#ifdef INP4FF_USE_INDEXED_POS
+    t_inp4ff_phase pos = interp->count;
+#else
+    t_inp4ff_phase pos = interp->position;
+#endif
+
+    /* temps */
+    int ipos;
+    t_inp4ff_pos fract;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    int k, index [8];
+    float fr [8];
+    t_inp4ff_phase q;
+#endif
+
+    dst = dst + interp->dst_index;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    /* groups of 8 while the last of the group is within src */
+    for (; n >= 8; n -= 8, dst += 8) {
+
+        for (k = 0, q = pos; k < 8; ++k) {
+#   if defined(INP4FF_USE_FIXED_POS)
+            ipos = (int)(q >> 32);
+            fract = INP4FF_PHASE_FRACT(q);
+            q += rate;
+#   elif defined(INP4FF_USE_INDEXED_POS)
+            fract = inp4ff__index_at(interp, rate, q, &ipos);
+            q += 1.0;
+#   else
+            ipos = (int)q;
+            fract = q - ipos;
+            q += rate;
+#   endif
+            index[k] = nsrc - 2 - ipos;
+            fr[k] = (float)(1.0 - fract);
+        }
+
+        if (ipos > maxpos) break;
+
+        _mm256_storeu_ps(dst, inp4ff__cubic_interp_avx2(src, _mm256_loadu_si256((const __m256i*)index), _mm256_loadu_ps(fr)));
+
+        pos = q;
+    }
+#endif
+
+    while (n > 0) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_at(interp, rate, pos, &ipos);
+#else
+        ipos = (int)pos;
+        fract = pos - ipos;
+#endif
+
+        if (ipos > maxpos) break;
+
+        *dst++ = inp4ff__cubic_interp(&src[nsrc - 3 - ipos], (t_inp4ff_pos)(1.0) - fract);
+
+#ifdef INP4FF_USE_INDEXED_POS
+        pos += 1.0;
+#else
+        pos += rate;
+#endif
+        n--;
+    }
+
+    num_read -= n;
+
+    /* store */
+#ifdef INP4FF_USE_INDEXED_POS
+    interp->count = pos;
+    pos = interp->count * rate + interp->base;
+#endif
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+/* Turns the direction src is read in. The position is mirrored within src,
+   the src of the latest call if it isn't through with it, and the one it
+   just ran out of otherwise, so a scrub goes back over it. The context gets
+   the start of src in the new direction. What lies past the edge behind the
+   turn hasn't been seen, so the context holds the edge sample in its place,
+   and a position further out than the context reaches starts at its end.
+   The next call then continues on src. */
+static void inp4ff__turn(inp4ff* interp, const t_inp4ff_src* src, int nsrc, int reverse)
+{
+    int j, m;
+    const t_inp4ff_src* first = reverse ? src + nsrc - 1 : src;
+    const int stride = reverse ? -1 : 1;
+
+    if (reverse == interp->reverse) return;
+
+    interp->reverse = reverse;
+
+    if (interp->state == Inp4State_Init) return;
+
+    if (interp->state == Inp4State_SrcDepleted) {
+
+        /* back from the next src to the one run out of, see inp4ff__advance_src */
+#ifdef INP4FF_USE_FIXED_POS
+        interp->position += (t_inp4ff_phase)nsrc * INP4FF_PHASE_ONE;
+#else
+        interp->position += nsrc;
+#endif
+#ifdef INP4FF_USE_COEFFS
+        interp->num_consumed -= nsrc;
+#endif
+    }
+
+#ifdef INP4FF_USE_FIXED_POS
+    interp->position = (t_inp4ff_phase)(nsrc - 1) * INP4FF_PHASE_ONE - interp->position;
+#else
+    interp->position = (t_inp4ff_phase)(nsrc - 1) - interp->position;
+#endif
+
+    if (interp->position < -4 * INP4FF_PHASE_ONE) {
+        interp->position = -4 * INP4FF_PHASE_ONE;
+    }
+
+    m = nsrc < 3 ? nsrc : 3;
+
+    for (j = 0; j < 5; ++j) {
+        interp->context[j] = *first;
+    }
+    for (j = 0; j < m; ++j) {
+        interp->context[5 + j] = first[j * stride];
+    }
+
+    interp->context_index = 5 + m;
+    interp->context_position = -5;
+    interp->state = Inp4State_DstDepleted;
+
+#ifdef INP4FF_USE_INDEXED_POS
+    /* count and base follow the mirrored position from the next call, no
+       rate matches this one */
+    interp->rate = -1.0;
+#endif
+
+#ifdef INP4FF_USE_COEFFS
+    /* the intervals of the ring are those of the other direction, a tag that
+       doesn't map to its own slot never matches */
+    for (j = 0; j < INP4FF_COEFF_RING_SIZE; ++j) {
+        interp->coeff_tags[j] = j + 1;
+    }
+#endif
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+
+/* inp4ff__read_from_src with the rate of each output read from rates, which
+   runs parallel to dst. Every output checks its own index against the end of
+   src, there's no estimate to go by. */
+static int inp4ff__read_varirate(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, const t_inp4ff_pos* rates, int n)
+{
+    int num_read = n; /* init to n, substract after loop */
+    const int maxpos = nsrc - 3;
+    t_inp4ff_phase pos = interp->position;
+
+    /* temps */
+    int ipos;
+    t_inp4ff_pos fract;
+
+    dst = dst + interp->dst_index;
+    rates = rates + interp->dst_index;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    if (nsrc > 3) {
+        n = inp4ff__read_varirate_avx2(&dst, src, nsrc, &pos, &rates, n);
+    }
+#endif
+
+    while (n > 0) {
+
+#ifdef INP4FF_USE_FIXED_POS
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#else
+        ipos = INP4FF_FLOOR_INT(pos);
+        fract = pos - ipos;
+#endif
+
+        if (ipos > maxpos) break;
+
+        *dst++ = inp4ff__cubic_interp(&src[ipos - 1], fract);
+
+        pos += inp4ff__phase_rate(*rates > 0 ? *rates : (t_inp4ff_pos)(0.0));
+        rates++;
+        n--;
+    }
+
+    num_read -= n;
+
+    /* store */
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+/* Reads the outputs of a ramp with the rate rate at dst[0], changing by step
+   per output. The number of outputs within src is known before the loop, so
+   the loop doesn't check the indices. */
+static int inp4ff__read_ramp(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, t_inp4ff_phase step, int n)
+{
+    const t_inp4ff_phase pos = interp->position;
+    int num_read, m = 0, k;
+    int index [8];
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    float fract [8];
+#else
+    t_inp4ff_pos fract [8];
+#endif
+
+#ifndef INP4FF_USE_FIXED_POS
+    /* truncation floors the positions only from zero up, in the context they
+       may be negative */
+    const int whole = pos >= 0;
+#endif
+
+    /* temps */
+    t_inp4ff_phase p;
+
+    /* on from the first output left to write */
+    rate += interp->dst_index * step;
+    dst = dst + interp->dst_index;
+
+    num_read = inp4ff__ramp_within(pos, rate, step, nsrc, n);
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2) && !defined(INP4FF_USE_FLOAT32_POS)
+    /* The positions are stepped in vector registers, leaving one output of
+       margin for their rounding against the closed form */
+    if (num_read > 8) {
+        m = num_read - 1 - inp4ff__read_ramp_avx2(&dst, src, nsrc, pos, rate, step, num_read - 1);
+    }
+#endif
+
+    /* The positions don't depend on each other, so those of a group are
+       worked out ahead of its cubics, in a loop the compiler can vectorise.
+       The last group is cut short. */
+    for (; m < num_read; m += 8, dst += 8) {
+
+        for (k = 0; k < 8; ++k) {
+            p = inp4ff__ramp_at(pos, rate, step, m + k);
+#ifdef INP4FF_USE_FIXED_POS
+            index[k] = (int)(p >> 32);
+            fract[k] = INP4FF_PHASE_FRACT(p);
+#else
+            index[k] = whole ? (int)p : INP4FF_FLOOR_INT(p);
+            fract[k] = p - index[k];
+#endif
+        }
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+        if (m + 8 <= num_read) {
+            _mm256_storeu_ps(dst, inp4ff__cubic_interp_avx2(src, _mm256_loadu_si256((const __m256i*)index), _mm256_loadu_ps(fract)));
+            continue;
+        }
+#endif
+
+        for (k = 0; k < 8 && m + k < num_read; ++k) {
+            dst[k] = inp4ff__cubic_interp(&src[index[k] - 1], fract[k]);
+        }
+    }
+
+    /* store */
+    interp->position = inp4ff__ramp_at(pos, rate, step, num_read);
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n - num_read;
+}
+
+#endif
+
+/* Weights of the four taps of the cubic at fract, as its responses to unit
+   taps, see inp4ff_ratio_init */
+static void inp4ff__weights(t_inp4ff_pos fract, t_inp4ff_src* w)
+{
+    int q;
+    t_inp4ff_src x [4];
+
+    for (q = 0; q < 4; ++q) {
+        x[0] = x[1] = x[2] = x[3] = (t_inp4ff_src)(0.0);
+        x[q] = (t_inp4ff_src)(1.0);
+        w[q] = (t_inp4ff_src)inp4ff__cubic_interp(x, fract);
+    }
+}
+
+/* dst[i] = w[0] * x[i] + w[1] * x[i + 1] + w[2] * x[i + 2] + w[3] * x[i + 3] */
+static void inp4ff__fir4(const t_inp4ff_src* x, const t_inp4ff_src* w, t_inp4ff_dst* dst, int n)
+{
+    int i = 0;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    const __m256 w0 = _mm256_set1_ps(w[0]), w1 = _mm256_set1_ps(w[1]);
+    const __m256 w2 = _mm256_set1_ps(w[2]), w3 = _mm256_set1_ps(w[3]);
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(w3, _mm256_loadu_ps(x + i + 3),
+                                  _mm256_fmadd_ps(w2, _mm256_loadu_ps(x + i + 2),
+                                  _mm256_fmadd_ps(w1, _mm256_loadu_ps(x + i + 1),
+                                  _mm256_mul_ps(w0, _mm256_loadu_ps(x + i))))));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        dst[i] = w[0] * x[i] + w[1] * x[i + 1] + w[2] * x[i + 2] + w[3] * x[i + 3];
+    }
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+
+/* Change of the rate per output of a ramp over ndst outputs. A fixed point
+   step is rounded to the nearest 2^-32 rather than truncated, so the rates
+   of a ramp don't all fall short of rate_end. */
+static t_inp4ff_phase inp4ff__ramp_step(t_inp4ff_phase rate_start, t_inp4ff_phase rate_end, int ndst)
+{
+    const t_inp4ff_phase change = rate_end - rate_start;
+
+    if (ndst <= 0) return 0;
+
+#ifdef INP4FF_USE_FIXED_POS
+    return (change + (change < 0 ? -(t_inp4ff_phase)(ndst / 2) : (t_inp4ff_phase)(ndst / 2))) / ndst;
+#else
+    return change / ndst;
+#endif
+}
+
+/* Position m outputs ahead on a ramp, pos + m * rate + m * (m - 1) / 2 * step.
+   With fixed point positions this is exact, and the same as adding up the
+   rates one by one. */
+static t_inp4ff_phase inp4ff__ramp_at(t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int m)
+{
+#ifdef INP4FF_USE_FIXED_POS
+    return pos + m * rate + (((t_inp4ff_phase)m * (m - 1)) >> 1) * step;
+#else
+    const t_inp4ff_phase k = (t_inp4ff_phase)m;
+    return pos + k * (rate + (t_inp4ff_pos)0.5 * (k - 1) * step);
+#endif
+}
+
+/* Number of the next n outputs of a ramp whose index is at most nsrc - 3.
+   Found from the root of the quadratic, and then checked against the
+   positions of inp4ff__ramp_at, which the root may miss by one. */
+static int inp4ff__ramp_within(t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int nsrc, int n)
+{
+#ifdef INP4FF_USE_FIXED_POS
+    const t_inp4ff_phase end = (t_inp4ff_phase)(nsrc - 2) * INP4FF_PHASE_ONE;
+    const double scale = 1.0 / INP4FF_PHASE_SCALE;
+#else
+    const t_inp4ff_phase end = (t_inp4ff_phase)(nsrc - 2);
+    const double scale = 1.0;
+#endif
+    /* a * m^2 + b * m + c reaches 0 at the end */
+    const double a = 0.5 * scale * (double)step;
+    const double b = scale * (double)rate - a;
+    const double c = scale * (double)(pos - end);
+    const double d = b * b - 4.0 * a * c;
+    double root;
+    int m = n;
+
+    if (n <= 0) return 0;
+
+    /* the smaller root, in a form that doesn't cancel when a is small */
+    if (d >= 0.0 && b + sqrt(d) > 0.0) {
+        root = -2.0 * c / (b + sqrt(d));
+        if (root < n) m = root > 0.0 ? (int)ceil(root) : 0;
+    }
+
+    while (m > 0 && inp4ff__ramp_at(pos, rate, step, m - 1) >= end) m--;
+    while (m < n && inp4ff__ramp_at(pos, rate, step, m) < end) m++;
+
+    return m;
+}
+
+#endif
+
+/* Interpolates up to n outputs from src while all four taps of the output lie
+   within src, i.e. while its index is at most nsrc - 3. The context is read
+   through here as well, as a window of src positions. Returns the number of
+   outputs left. */
+static int inp4ff__read_from_src(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase rate, int n)
+{
+    int num_read = n; /* init to n, substract after loop*/
+    const int maxpos = nsrc - 3;
+#ifdef INP4FF_USE_INDEXED_POS
+    /* the kernels step the output count instead of the position */
+    t_inp4ff_phase pos = interp->count;
+#else
+    t_inp4ff_phase pos = interp->position;
+#endif
+
+    /* temps */
+    int ipos, index, step, m, nfast;
+    t_inp4ff_pos fract;
+
+    /* The outputs up to the estimate are read without checking the index,
+       leaving one output of margin for its rounding. It doesn't pay off for
+       the few outputs on the context, which holds at most 3 samples of src. */
+    nfast = nsrc > 3 ? inp4ff__num_within(interp, rate, nsrc, n) - 1 : 0;
+
+    dst = dst + interp->dst_index;
+
+    /* At a whole position and a whole rate every output is a src sample */
+#ifdef INP4FF_USE_FIXED_POS
+    if (!(rate & INP4FF_PHASE_MASK) && !(pos & INP4FF_PHASE_MASK)) {
+        ipos = (int)(pos >> 32);
+        step = (int)(rate >> 32);
+#else
+    if (rate == (int)rate && interp->position == (int)interp->position) {
+        ipos = (int)interp->position;
+        step = (int)rate;
+#endif
+        if (ipos <= maxpos) {
+
+            m = step > 0 ? (maxpos - ipos) / step + 1 : n;
+            if (m > n) m = n;
+
+            inp4ff__copy_from_src(dst, &src[ipos], step, m);
+            dst += m;
+#ifdef INP4FF_USE_INDEXED_POS
+            pos += m;
+#else
+            pos += m * rate;
+#endif
+            n -= m;
+            nfast -= m;
+        }
+    }
+
+#ifdef INP4FF_USE_COEFFS
+    /* Upsampling with precomputed coefficients replaces the vector kernels */
+    while (rate <= INP4FF_COEFF_MAX_RATE && n > 0) {
+
+#   if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#   elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_at(interp, rate, pos, &ipos);
+#   else
+        ipos = INP4FF_FLOOR_INT(pos);
+        fract = pos - ipos;
+#   endif
+
+        if (ipos > maxpos) break;
+
+        *dst++ = inp4ff__cubic_interp_coeffs(interp, &src[ipos - 1], ipos, fract);
+
+#   ifdef INP4FF_USE_INDEXED_POS
+        pos += 1.0;
+#   else
+        pos += rate;
+#   endif
+        n--;
+        nfast--;
+    }
+#endif
+
+#if !defined(INP4FF_USE_FIXED_POS) && !defined(INP4FF_USE_INDEXED_POS)
+    /* truncation floors the positions only from zero up, in the context they
+       may be negative */
+    if (pos < 0) nfast = 0;
+#endif
+
+    if (nfast > n) nfast = n;
+
+#ifdef INP4FF__USE_VECTOR
+    if (nfast >= 8) {
+
+        m = nfast;
+
+#   ifdef INP4FF_USE_AVX2
+        /* When upsampling the taps of consecutive outputs overlap, and are
+           cheaper to permute from a window than to gather. */
+        if (rate <= INP4FF_PHASE_ONE) {
+            m = inp4ff__read_from_src_upsample_avx2(interp, &dst, src, nsrc, &pos, rate, m);
+        }
+#   endif
+
+#   ifdef INP4FF_USE_AVX512
+        /* bulk of the block in groups of 16 */
+        m = inp4ff__read_from_src_avx512(interp, &dst, src, &pos, rate, m);
+#   endif
+
+#   ifdef INP4FF_USE_AVX2
+        /* bulk of the block in groups of 8, the scalar loop takes the remainder */
+        m = inp4ff__read_from_src_avx2(interp, &dst, src, &pos, rate, m);
+#   endif
+
+        n -= nfast - m;
+        nfast = m;
+    }
+#endif
+
+    while (nfast > 0) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_at(interp, rate, pos, &ipos);
+#else
+        ipos = (int)(pos);
+        fract = pos - ipos;
+#endif
+        index = ipos - 1;
+        
+        *dst++ = inp4ff__cubic_interp(&src[index], fract);
+        
+#ifdef INP4FF_USE_INDEXED_POS
+        pos += 1.0;
+#else
+        pos += rate;
+#endif
+        n--;
+        nfast--;
+    }
+
+    /* the last outputs one by one up to the end of src */
+    while (n > 0) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_at(interp, rate, pos, &ipos);
+#else
+        ipos = INP4FF_FLOOR_INT(pos);
+        fract = pos - ipos;
+#endif
+
+        if (ipos > maxpos) break;
+
+        *dst++ = inp4ff__cubic_interp(&src[ipos - 1], fract);
+
+#ifdef INP4FF_USE_INDEXED_POS
+        pos += 1.0;
+#else
+        pos += rate;
+#endif
+        n--;
+    }
+    
+    num_read -= n;
+
+    /* store */
+#ifdef INP4FF_USE_INDEXED_POS
+    interp->count = pos;
+    pos = interp->count * rate + interp->base;
+#endif
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+static void inp4ff__post_process(inp4ff* interp, const t_inp4ff_src* src, int nsrc, int stride)
+{
+    int j;
+
+    if (inp4ff__advance_src(interp, interp->context, nsrc, 1)) {
+
+        for (j = 0; j < 3; ++j) {
+            interp->context[2 + j] = src[(nsrc - 3 + j) * stride];
+        }
+    }
+}
+
+static void inp4ff__post_process_frames(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* src, int nsrc, int nch)
+{
+    int j;
+
+    if (inp4ff__advance_src(interp, context, nsrc, nch)) {
+
+        for (j = 0; j < 3 * nch; ++j) {
+            context[2 * nch + j] = src[(nsrc - 3) * nch + j];
+        }
+    }
+}
+
+static void inp4ff__post_process_planar(inp4ff* interp, t_inp4ff_src* context, const t_inp4ff_src* const* src, int nsrc, int nch)
+{
+    int j, c;
+
+    if (inp4ff__advance_src(interp, context, nsrc, nch)) {
+
+        for (j = 0; j < 3; ++j) {
+            for (c = 0; c < nch; ++c) {
+                context[(2 + j) * nch + c] = src[c][nsrc - 3 + j];
+            }
+        }
+    }
+}
+
+/* inp4ff__push_to_context for a lane of a batch */
+static void inp4ff__batch_push(inp4ff_batch* batch, int lane, const t_inp4ff_src* src, int nsrc)
+{
+    int i, j, m;
+    t_inp4ff_src* context = batch->context[lane];
+
+    m = nsrc < 3 ? nsrc : 3;
+    
+    for (i = 0; i < m; ++i) {
+
+        if (batch->context_index[lane] == INP4FF_CTX_SIZE) {
+
+            for (j = 0; j < 5; ++j) {
+                context[j] = context[INP4FF_CTX_SIZE - 5 + j];
+            }
+            batch->context_index[lane] = 5;
+            batch->context_position[lane] += INP4FF_CTX_SIZE - 5;
+        }
+
+        context[batch->context_index[lane]++] = src[i];
+    }
+}
+
+/* inp4ff__post_process for a lane of a batch */
+static void inp4ff__batch_post_process(inp4ff_batch* batch, int lane, const t_inp4ff_src* src, int nsrc)
+{
+    t_inp4ff_src* context = batch->context[lane];
+
+    if (batch->state[lane] == Inp4State_SrcDepleted) {
+
+#ifdef INP4FF_USE_FIXED_POS
+        batch->position[lane] -= (t_inp4ff_phase)nsrc * INP4FF_PHASE_ONE;
+#else
+        batch->position[lane] -= nsrc;
+#endif
+#ifdef INP4FF_USE_INDEXED_POS
+        batch->base[lane] -= nsrc;
+#endif
+
+        if (nsrc > 3) {
+
+            context[0] = context[batch->context_index[lane] - 2];
+            context[1] = context[batch->context_index[lane] - 1];
+            context[2] = src[nsrc - 3];
+            context[3] = src[nsrc - 2];
+            context[4] = src[nsrc - 1];
+
+            batch->context_index[lane] = 5;
+            batch->context_position[lane] = -5;
+
+        } else {
+            batch->context_position[lane] -= nsrc;
+        }
+    }
+    else if (batch->state[lane] == Inp4State_DstDepleted)
+    {
+        batch->dst_index[lane] = 0;
+    }
+}
+
+#ifdef INP4FF__USE_BATCH_VECTOR
+
+/* The cubic of one output of every lane, x[k] holding tap k of the lanes */
+static void inp4ff__cubic_eval_lanes(t_inp4ff_src x [4][INP4FF_BATCH_LANES], const t_inp4ff_pos* fract, t_inp4ff_dst* y)
+{
+    int l = 0;
+    t_inp4ff_src taps [4];
+    __m256 f;
+
+    for (; l + 8 <= INP4FF_BATCH_LANES; l += 8) {
+
+        f = _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(&fract[l + 4])),
+                            _mm256_cvtpd_ps(_mm256_loadu_pd(&fract[l])));
+        _mm256_storeu_ps(&y[l], inp4ff__cubic_eval_avx2(_mm256_loadu_ps(&x[0][l]), _mm256_loadu_ps(&x[1][l]),
+                                                        _mm256_loadu_ps(&x[2][l]), _mm256_loadu_ps(&x[3][l]), f));
+    }
+
+    for (; l < INP4FF_BATCH_LANES; ++l) {
+
+        taps[0] = x[0][l];
+        taps[1] = x[1][l];
+        taps[2] = x[2][l];
+        taps[3] = x[3][l];
+
+        y[l] = inp4ff__cubic_interp(taps, fract[l]);
+    }
+}
+
+#else
+
+/* Up to n outputs of a lane of a batch at rate, read from the context window
+   up to max_context and from src up to max_src. Returns the number of outputs
+   left once src is depleted. */
+static int inp4ff__read_lane(const inp4ff_batch* batch, int lane, t_inp4ff_dst** out, const t_inp4ff_src* window, const t_inp4ff_src* src,
+                             int max_context, int max_src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n)
+{
+    int ipos;
+    t_inp4ff_pos fract;
+    const t_inp4ff_src* x;
+    t_inp4ff_phase p = *pos;
+    t_inp4ff_dst* d = *out;
+
+    for (; n > 0; --n) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(p >> 32);
+        fract = INP4FF_PHASE_FRACT(p);
+#elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_of(p, batch->base[lane], rate, &ipos);
+#else
+        ipos = INP4FF_FLOOR_INT(p);
+        fract = p - ipos;
+#endif
+
+        if (ipos <= max_context) {
+            x = &window[ipos - 1];
+        } else if (ipos <= max_src) {
+            x = &src[ipos - 1];
+        } else {
+            break;
+        }
+
+        *d++ = inp4ff__cubic_interp(x, fract);
+
+#ifdef INP4FF_USE_INDEXED_POS
+        p += 1.0;
+#else
+        p += rate;
+#endif
+    }
+
+    *pos = p;
+    *out = d;
+
+    return n;
+}
+
+#endif /* INP4FF__USE_BATCH_VECTOR */
+
+/* The rate in the type of the positions */
+static t_inp4ff_phase inp4ff__phase_rate(t_inp4ff_pos rate)
+{
+#ifdef INP4FF_USE_FIXED_POS
+    return (t_inp4ff_phase)(rate * INP4FF_PHASE_SCALE + 0.5);
+#else
+    return rate;
+#endif
+}
+
+/* Address in src of the first tap the voice reads next. A voice that is still
+   on its context gives the start of src, and one past src its end. A reverse
+   voice reads downwards, it gives the lower end of the lines fetched for it,
+   see inp4ff__voice_lines. */
+static const t_inp4ff_src* inp4ff__voice_address(const inp4ff_voice* voice)
+{
+    int ipos, start;
+    const inp4ff* interp = voice->interp;
+    t_inp4ff_phase pos = interp->position;
+    int mirrored = voice->rate < 0;
+
+    /* a state that turns in inp4ff_process still counts in its direction,
+       from src if it ran out of it, see inp4ff__turn */
+    if (interp->state != Inp4State_Init && interp->reverse != mirrored) {
+
+        mirrored = interp->reverse;
+
+        if (interp->state == Inp4State_SrcDepleted) {
+            pos += (t_inp4ff_phase)voice->nsrc * INP4FF_PHASE_ONE;
+        }
+    }
+
+#if defined(INP4FF_USE_FIXED_POS)
+    ipos = (int)((mirrored ? (t_inp4ff_phase)(voice->nsrc - 1) * INP4FF_PHASE_ONE - pos : pos) >> 32);
+#else
+    ipos = INP4FF_FLOOR_INT(mirrored ? (t_inp4ff_pos)(voice->nsrc - 1) - pos : pos);
+#endif
+
+    if (voice->rate < 0) {
+
+        /* the taps reach up to ipos + 1 */
+        start = ipos + 2 - inp4ff__voice_lines(voice) * (int)(INP4FF_CACHE_LINE / sizeof(t_inp4ff_src));
+
+        if (start > voice->nsrc) start = voice->nsrc;
+        if (start < 0) start = 0;
+
+        return voice->src + start;
+    }
+
+    if (ipos > voice->nsrc) ipos = voice->nsrc;
+    if (ipos < 1) ipos = 1;
+
+    return voice->src + ipos - 1;
+}
+
+/* Cache lines of src the voice reads in its block, up to INP4FF_PREFETCH_LINES */
+static int inp4ff__voice_lines(const inp4ff_voice* voice)
+{
+    const int num_lines = (int)((voice->ndst * fabs(voice->rate) + 4) * sizeof(t_inp4ff_src) / INP4FF_CACHE_LINE) + 1;
+
+    return num_lines < INP4FF_PREFETCH_LINES ? num_lines : INP4FF_PREFETCH_LINES;
+}
+
+/* End of the group of voices starting at order[i], in the order of
+   inp4ff_schedule. The group takes the voices that start within the lines
+   read by the ones before them, until it spans INP4FF_GROUP_LINES. begin and
+   end are set to the bytes of src the group reads. */
+static int inp4ff__voice_group(const inp4ff_voice* voices, const int* order, int i, int num_voices, size_t* begin, size_t* end)
+{
+    size_t address;
+    const inp4ff_voice* voice = &voices[order[i]];
+
+    *begin = (size_t)inp4ff__voice_address(voice);
+    *end = *begin + (size_t)inp4ff__voice_lines(voice) * INP4FF_CACHE_LINE;
+
+    for (++i; i < num_voices && *end - *begin < (size_t)INP4FF_GROUP_LINES * INP4FF_CACHE_LINE; ++i) {
+
+        voice = &voices[order[i]];
+        address = (size_t)inp4ff__voice_address(voice);
+
+        if (address >= *end) break;
+
+        address += (size_t)inp4ff__voice_lines(voice) * INP4FF_CACHE_LINE;
+        if (address > *end) *end = address;
+    }
+
+    return i;
+}
+
+/* Moves the position and the context past a depleted src. Returns nonzero
+   when the last 3 frames of src are to be copied to the context after the 2
+   frames it keeps. */
+static int inp4ff__advance_src(inp4ff* interp, t_inp4ff_src* context, int nsrc, int nch)
+{
+    int j;
+
+    if (interp->state == Inp4State_SrcDepleted) {
+
+#ifdef INP4FF_USE_FIXED_POS
+        interp->position -= (t_inp4ff_phase)nsrc * INP4FF_PHASE_ONE;
+#else
+        interp->position -= nsrc;
+#endif
+#ifdef INP4FF_USE_INDEXED_POS
+        interp->base -= nsrc;
+#endif
+#ifdef INP4FF_USE_COEFFS
+        interp->num_consumed += nsrc;
+#endif
+        
+        /* Fill the context by copying the 2 last and by reading 3 new elements
+           to the beginning of the context. If nsrc is not greater than we've
+           already pushed all available samples before the interpolation. */
+        if (nsrc > 3) {
+
+            for (j = 0; j < 2 * nch; ++j) {
+                context[j] = context[(interp->context_index - 2) * nch + j];
+            }
+            
+            interp->context_index = 5;
+            interp->context_position = -5;
+
+            return 1;
+        }
+
+        interp->context_position -= nsrc;
+    }
+    else if (interp->state == Inp4State_DstDepleted)
+    {
+        interp->dst_index = 0;
+    }
+
+    return 0;
+}
+
+/* Interpolates up to n output frames of nch channels from the interleaved
+   frames of src while the taps lie within src, see inp4ff__read_from_src.
+   Returns the number of frames left. */
+static int inp4ff__read_frames(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, int nch, t_inp4ff_phase rate, int n)
+{
+    int num_read = n; /* init to n, substract after loop */
+    const int maxpos = nsrc - 3;
+#ifdef INP4FF_USE_INDEXED_POS
+    t_inp4ff_phase pos = interp->count;
+#else
+    t_inp4ff_phase pos = interp->position;
+#endif
+
+    /* temps */
+    int ipos;
+    t_inp4ff_pos fract;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    int nfast;
+#endif
+
+    dst = dst + interp->dst_index * nch;
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    /* the estimate of inp4ff__read_from_src, a whole frame takes a vector of
+       its own and is left to the scalar loop */
+    nfast = nsrc > 3 && nch != 8 ? inp4ff__num_within(interp, rate, nsrc, n) - 1 : 0;
+
+#   if !defined(INP4FF_USE_FIXED_POS) && !defined(INP4FF_USE_INDEXED_POS)
+    if (pos < 0) nfast = 0;
+#   endif
+
+    if (nfast >= 8) {
+        n -= nfast - inp4ff__read_frames_avx2(interp, &dst, src, nch, &pos, rate, nfast);
+    }
+#endif
+
+    while (n > 0) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        fract = INP4FF_PHASE_FRACT(pos);
+#elif defined(INP4FF_USE_INDEXED_POS)
+        fract = inp4ff__index_at(interp, rate, pos, &ipos);
+#else
+        ipos = INP4FF_FLOOR_INT(pos);
+        fract = pos - ipos;
+#endif
+
+        if (ipos > maxpos) break;
+
+        inp4ff__cubic_interp_frame(&src[(ipos - 1) * nch], nch, fract, dst);
+        dst += nch;
+
+#ifdef INP4FF_USE_INDEXED_POS
+        pos += 1.0;
+#else
+        pos += rate;
+#endif
+        n--;
+    }
+
+    num_read -= n;
+
+    /* store */
+#ifdef INP4FF_USE_INDEXED_POS
+    interp->count = pos;
+    pos = interp->count * rate + interp->base;
+#endif
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+/* inp4ff__cubic_interp for the nch channels of a frame, x[c] being the first
+   tap of channel c. The common layouts are vectorised across the channels
+   in single precision, like inp4ff__read_frames_avx2. */
+static void inp4ff__cubic_interp_frame(const t_inp4ff_src* x, int nch, t_inp4ff_pos fract, t_inp4ff_dst* dst)
+{
+    int c = 0;
+    t_inp4ff_src taps [4];
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    const __m128 f = _mm_set1_ps((float)fract);
+
+    if (nch == 8) {
+
+        _mm256_storeu_ps(dst, inp4ff__cubic_eval_avx2(_mm256_loadu_ps(x), _mm256_loadu_ps(x + 8),
+                                                      _mm256_loadu_ps(x + 16), _mm256_loadu_ps(x + 24),
+                                                      _mm256_set1_ps((float)fract)));
+        return;
+    }
+
+    if (nch == 2) {
+
+        const __m128 value = inp4ff__cubic_eval_sse(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)x)),
+                                                    _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(x + 2))),
+                                                    _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(x + 4))),
+                                                    _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(x + 6))), f);
+        _mm_storel_epi64((__m128i*)dst, _mm_castps_si128(value));
+        return;
+    }
+
+    /* quad, and the first four channels of 5.1 */
+    if (nch >= 4) {
+
+        _mm_storeu_ps(dst, inp4ff__cubic_eval_sse(_mm_loadu_ps(x), _mm_loadu_ps(x + nch),
+                                                  _mm_loadu_ps(x + 2 * nch), _mm_loadu_ps(x + 3 * nch), f));
+        c = 4;
+    }
+#endif
+
+    for (; c < nch; ++c) {
+
+        taps[0] = x[c];
+        taps[1] = x[nch + c];
+        taps[2] = x[2 * nch + c];
+        taps[3] = x[3 * nch + c];
+
+        dst[c] = inp4ff__cubic_interp(taps, fract);
+    }
+}
+
+/* Interpolates up to n outputs for each of the nch channels, src[c] holding
+   the samples of channel c step apart, and dst[c] taking its outputs dst_step
+   apart. Returns the number of outputs left. */
+static int inp4ff__read_planar(inp4ff* interp, t_inp4ff_dst* const* dst, int dst_step, const t_inp4ff_src* const* src, int step, int nsrc, int nch, t_inp4ff_phase rate, int n)
+{
+    int num_read = n; /* init to n, substract after loop */
+    const int maxpos = nsrc - 3;
+#ifdef INP4FF_USE_INDEXED_POS
+    t_inp4ff_phase pos = interp->count;
+#else
+    t_inp4ff_phase pos = interp->position;
+#endif
+
+    /* one block of positions */
+    int index [INP4FF_BLOCK_SIZE];
+    t_inp4ff_pos fract [INP4FF_BLOCK_SIZE];
+
+    /* temps */
+    int ipos, c, m, max_m;
+
+    while (n > 0) {
+
+        max_m = n < INP4FF_BLOCK_SIZE ? n : INP4FF_BLOCK_SIZE;
+
+        for (m = 0; m < max_m; ++m) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+            ipos = (int)(pos >> 32);
+            fract[m] = INP4FF_PHASE_FRACT(pos);
+#elif defined(INP4FF_USE_INDEXED_POS)
+            fract[m] = inp4ff__index_at(interp, rate, pos, &ipos);
+#else
+            ipos = INP4FF_FLOOR_INT(pos);
+            fract[m] = pos - ipos;
+#endif
+
+            if (ipos > maxpos) break;
+
+            index[m] = ipos;
+
+#ifdef INP4FF_USE_INDEXED_POS
+            pos += 1.0;
+#else
+            pos += rate;
+#endif
+        }
+
+        for (c = 0; c < nch; ++c) {
+            inp4ff__cubic_interp_block(src[c], step, index, fract, m,
+                                       dst[c] + (interp->dst_index + num_read - n) * dst_step, dst_step);
+        }
+
+        n -= m;
+
+        if (m < max_m) break;
+    }
+
+    num_read -= n;
+
+    /* store */
+#ifdef INP4FF_USE_INDEXED_POS
+    interp->count = pos;
+    pos = interp->count * rate + interp->base;
+#endif
+    interp->position = pos;
+    interp->dst_index += num_read;
+    interp->num_remaining -= num_read;
+
+    return n;
+}
+
+/* Interpolates m outputs at the src indices and fractions of a block */
+static void inp4ff__cubic_interp_block(const t_inp4ff_src* src, int step, const int* index, const t_inp4ff_pos* fract, int m, t_inp4ff_dst* dst, int dst_step)
+{
+    int k = 0;
+    t_inp4ff_src taps [4];
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+    __m256 f;
+
+    if (step == 1 && dst_step == 1) {
+
+        for (; k + 8 <= m; k += 8) {
+
+#   ifdef INP4FF_USE_FLOAT32_POS
+            f = _mm256_loadu_ps(&fract[k]);
+#   else
+            f = _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(&fract[k + 4])),
+                                _mm256_cvtpd_ps(_mm256_loadu_pd(&fract[k])));
+#   endif
+            _mm256_storeu_ps(&dst[k], inp4ff__cubic_interp_avx2(src, _mm256_loadu_si256((const __m256i*)&index[k]), f));
+        }
+    }
+#endif
+
+    if (step == 1) {
+
+        for (; k < m; ++k) {
+            dst[k * dst_step] = inp4ff__cubic_interp(&src[index[k] - 1], fract[k]);
+        }
+        return;
+    }
+
+    for (; k < m; ++k) {
+
+        taps[0] = src[(index[k] - 1) * step];
+        taps[1] = src[index[k] * step];
+        taps[2] = src[(index[k] + 1) * step];
+        taps[3] = src[(index[k] + 2) * step];
+
+        dst[k * dst_step] = inp4ff__cubic_interp(taps, fract[k]);
+    }
+}
+
+/* Estimates how many of the next n outputs have their index at most
+   nsrc - 3. Off by one at most, as the positions are rounded differently. */
+static int inp4ff__num_within(const inp4ff* interp, t_inp4ff_phase rate, int nsrc, int n)
+{
+    t_inp4ff_phase m;
+
+    if (rate <= 0) return 0;
+
+#ifdef INP4FF_USE_FIXED_POS
+    m = ((t_inp4ff_phase)(nsrc - 2) * INP4FF_PHASE_ONE - interp->position + rate - 1) / rate;
+#else
+    m = ((t_inp4ff_pos)(nsrc - 2) - interp->position) / rate;
+#endif
+
+    if (m <= 0) return 0;
+    if (m >= n) return n;
+
+#ifdef INP4FF_USE_FIXED_POS
+    return (int)m;
+#else
+    /* ceil */
+    return (int)m + ((int)m < m);
+#endif
+}
+
+/* Reads n outputs through the period table of interp->ratio while all taps
+   lie within src, see inp4ff__read_from_src. Returns the number of outputs
+   left unwritten. */
+static int inp4ff__read_ratio(inp4ff* interp, t_inp4ff_dst* dst, const t_inp4ff_src* src, int nsrc, int n)
+{
+    int num_read = n; /* init to n, substract after loop */
+    int ipos, index, phase = interp->ratio_phase;
+    const t_inp4ff_dst* w;
+    const inp4ff_ratio* ratio = interp->ratio;
+    const int maxpos = nsrc - 3;
+
+#ifdef INP4FF_USE_FIXED_POS
+    ipos = (int)(interp->position >> 32);
+#else
+    ipos = (int)(interp->position);
+#endif
+
+    dst = dst + interp->dst_index;
+
+    while (ipos <= maxpos && n > 0) {
+
+        index = ipos - 1;
+        w = ratio->weights[phase];
+        *dst++ = w[0] * src[index] + w[1] * src[index + 1] + w[2] * src[index + 2] + w[3] * src[index + 3];
+
+        ipos += ratio->advance[phase];
+        if (++phase == ratio->up) phase = 0;
+        n--;
+    }
+    num_read -= n;
+
+    /* store, the position of a ratio state is always whole */
+    interp->position = (t_inp4ff_phase)ipos * INP4FF_PHASE_ONE;
+    interp->ratio_phase = phase;
+    interp->num_remaining -= num_read;
+    interp->dst_index += num_read;
+
+    return n;
+}
+
+#ifdef INP4FF_USE_INDEXED_POS
+
+/* Integer part and fraction of the local position at output count, as
+   stepped by the kernels. The product is split before adding base, which
+   keeps the fraction independent of base and rules out contracting it to an
+   FMA. count has a fraction of its own after inp4ff__anchor. */
+static t_inp4ff_pos inp4ff__index_at(const inp4ff* interp, t_inp4ff_pos rate, t_inp4ff_pos count, int* ipos)
+{
+    return inp4ff__index_of(count, interp->base, rate, ipos);
+}
+
+/* inp4ff__index_at for the output count of a state with the given base */
+static t_inp4ff_pos inp4ff__index_of(t_inp4ff_pos count, t_inp4ff_pos base, t_inp4ff_pos rate, int* ipos)
+{
+#if defined(INP4FF_USE_AVX2) || defined(INP4FF_USE_AVX512)
+
+    /* FMA is available, spell out the rounding of the vector kernels */
+    const __m128d p = _mm_mul_sd(_mm_set_sd(count), _mm_set_sd(rate));
+    const __m128d whole = _mm_round_sd(p, p, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+    *ipos = (int)(_mm_cvtsd_f64(whole) + base);
+
+    return _mm_cvtsd_f64(_mm_sub_sd(p, whole));
+
+#else
+
+    const t_inp4ff_pos p = count * rate;
+    const t_inp4ff_pos whole = INP4FF_FLOOR(p);
+
+    *ipos = (int)(whole + base);
+
+    return p - whole;
+
+#endif
+}
+
+/* Re-anchors count and base to the current position when the rate changes.
+   base takes the whole part of the position, and count the fraction in
+   outputs of the new rate, so the next output goes on from where the
+   previous rate left off. */
+static void inp4ff__anchor(inp4ff* interp, t_inp4ff_pos rate)
+{
+    if (rate == interp->rate) return;
+
+    interp->base = INP4FF_FLOOR(interp->position);
+    interp->count = rate > 0 ? (interp->position - interp->base) / rate : 0.0;
+    interp->rate = rate;
+}
+
+#endif /* INP4FF_USE_INDEXED_POS */
+
+#ifdef INP4FF_USE_COEFFS
+
+/* inp4ff__cubic_interp through the coefficient ring. ipos is the local
+   position of x[1], and identifies the interval together with the number of
+   consumed samples. The cubic expands to
+
+   x1 + (d - B / 6) f + (B - A) / 6 f^2 + A / 6 f^3
+
+   with d = x2 - x1, A = x3 - x0 - 3 d and B = x3 + 2 x0 - 3 x1. */
+static t_inp4ff_dst inp4ff__cubic_interp_coeffs(inp4ff* interp, const t_inp4ff_src* x, int ipos, t_inp4ff_pos fract)
+{
+    const unsigned int interval = interp->num_consumed + (unsigned int)ipos;
+    t_inp4ff_pos* c = interp->coeffs[interval & (INP4FF_COEFF_RING_SIZE - 1)];
+
+    if (interp->coeff_tags[interval & (INP4FF_COEFF_RING_SIZE - 1)] != interval) {
+
+        const t_inp4ff_pos k = (t_inp4ff_dst)(0.1666667);
+        const t_inp4ff_pos x21_diff = (t_inp4ff_pos)x[2] - x[1];
+        const t_inp4ff_pos a = (t_inp4ff_pos)x[3] - x[0] - 3.0 * x21_diff;
+        const t_inp4ff_pos b = (t_inp4ff_pos)x[3] + 2.0 * x[0] - 3.0 * x[1];
+
+        c[0] = x[1];
+        c[1] = x21_diff - k * b;
+        c[2] = k * (b - a);
+        c[3] = k * a;
+
+        interp->coeff_tags[interval & (INP4FF_COEFF_RING_SIZE - 1)] = interval;
+    }
+
+    return (t_inp4ff_dst)(((c[3] * fract + c[2]) * fract + c[1]) * fract + c[0]);
+}
+
+#endif /* INP4FF_USE_COEFFS */
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX2)
+
+/* 8-wide version of inp4ff__cubic_interp. The four taps of each lane are
+   gathered from src[index - 1] ... src[index + 2].
+
+   The scalar version evaluates the polynomial in the precision of
+   t_inp4ff_pos, this one in single precision with fused multiply-adds. With
+   taps in range [-1, 1] the results stay within 4 ulp of 1.0 (~4.8e-7) from
+   the scalar path, which is below the resolution of a 24-bit output. */
+static __m256 inp4ff__cubic_interp_avx2(const t_inp4ff_src* src, __m256i index, __m256 fract)
+{
+    return inp4ff__cubic_eval_avx2(_mm256_i32gather_ps(src - 1, index, 4),
+                                   _mm256_i32gather_ps(src, index, 4),
+                                   _mm256_i32gather_ps(src + 1, index, 4),
+                                   _mm256_i32gather_ps(src + 2, index, 4),
+                                   fract);
+}
+
+/* The cubic on 8 lanes of taps */
+static __m256 inp4ff__cubic_eval_avx2(__m256 x0, __m256 x1, __m256 x2, __m256 x3, __m256 fract)
+{
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 x21_diff = _mm256_sub_ps(x2, x1);
+
+    /* c = (x3 - x0 - 3 * x21_diff) * fract + (x3 + 2 * x0 - 3 * x1) */
+    const __m256 c = _mm256_fmadd_ps(_mm256_fnmadd_ps(three, x21_diff, _mm256_sub_ps(x3, x0)), fract,
+                                     _mm256_fnmadd_ps(three, x1, _mm256_fmadd_ps(_mm256_set1_ps(2.0f), x0, x3)));
+
+    /* value = x1 + fract * (x21_diff - 1/6 * (1 - fract) * c) */
+    const __m256 k = _mm256_mul_ps(_mm256_set1_ps(0.1666667f), _mm256_sub_ps(_mm256_set1_ps(1.0f), fract));
+
+    return _mm256_fmadd_ps(fract, _mm256_fnmadd_ps(k, c, x21_diff), x1);
+}
+
+/* The cubic on 4 lanes of taps, same operations as inp4ff__cubic_eval_avx2 */
+static __m128 inp4ff__cubic_eval_sse(__m128 x0, __m128 x1, __m128 x2, __m128 x3, __m128 fract)
+{
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 x21_diff = _mm_sub_ps(x2, x1);
+
+    const __m128 c = _mm_fmadd_ps(_mm_fnmadd_ps(three, x21_diff, _mm_sub_ps(x3, x0)), fract,
+                                  _mm_fnmadd_ps(three, x1, _mm_fmadd_ps(_mm_set1_ps(2.0f), x0, x3)));
+
+    const __m128 k = _mm_mul_ps(_mm_set1_ps(0.1666667f), _mm_sub_ps(_mm_set1_ps(1.0f), fract));
+
+    return _mm_fmadd_ps(fract, _mm_fnmadd_ps(k, c, x21_diff), x1);
+}
+
+#ifdef INP4FF__USE_BATCH_VECTOR
+
+/* m outputs of each of 8 lanes of a batch, lane l at pos[l] in src[l]. The
+   taps are gathered at byte offsets from the lowest src of the active lanes,
+   and the lanes that aren't active are masked out. */
+static void inp4ff__read_lanes_avx2(const t_inp4ff_src* const* src, const int* active, t_inp4ff_phase* pos, const t_inp4ff_phase* rate, t_inp4ff_dst** out, int m)
+{
+    int l, k;
+    const t_inp4ff_src* base = 0;
+    long long addr [8];
+    int step [8];
+    t_inp4ff_phase lane_rate [8];
+    t_inp4ff_dst y [8];
+    t_inp4ff_dst scratch [8];
+
+    __m256d p_lo = _mm256_loadu_pd(pos), p_hi = _mm256_loadu_pd(pos + 4);
+    __m256d r_lo, r_hi, f_lo, f_hi;
+    __m256i a_lo, a_hi, base_lo, base_hi;
+    __m128 mask_lo, mask_hi;
+    __m256 fract;
+    __m256 x [4];
+    const __m128 zero = _mm_setzero_ps();
+
+    /* addresses of different src only compare as integers */
+    for (l = 0; l < 8; ++l) {
+        if (active[l] && (base == 0 || (size_t)src[l] < (size_t)base)) base = src[l];
+    }
+    if (base == 0) return;
+
+    /* byte offset of tap 0 at position 0, and a scratch output and no steps
+       for the inactive lanes */
+    for (l = 0; l < 8; ++l) {
+        addr[l] = active[l] ? (long long)((size_t)src[l] - (size_t)base) - (long long)sizeof(t_inp4ff_src) : 0;
+        step[l] = active[l];
+        lane_rate[l] = active[l] ? rate[l] : 0.0;
+        if (!active[l]) out[l] = &scratch[l];
+    }
+
+    r_lo = _mm256_loadu_pd(lane_rate);
+    r_hi = _mm256_loadu_pd(lane_rate + 4);
+
+    base_lo = _mm256_loadu_si256((const __m256i*)addr);
+    base_hi = _mm256_loadu_si256((const __m256i*)(addr + 4));
+    mask_lo = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)active), _mm_setzero_si128()));
+    mask_hi = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(active + 4)), _mm_setzero_si128()));
+
+    for (k = 0; k < m; ++k) {
+
+        f_lo = _mm256_floor_pd(p_lo);
+        f_hi = _mm256_floor_pd(p_hi);
+        fract = _mm256_set_m128(_mm256_cvtpd_ps(_mm256_sub_pd(p_hi, f_hi)), _mm256_cvtpd_ps(_mm256_sub_pd(p_lo, f_lo)));
+
+        a_lo = _mm256_add_epi64(base_lo, _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(f_lo)), 2));
+        a_hi = _mm256_add_epi64(base_hi, _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(f_hi)), 2));
+
+        for (l = 0; l < 4; ++l) {
+            x[l] = _mm256_set_m128(_mm256_mask_i64gather_ps(zero, base + l, a_hi, mask_hi, 1),
+                                   _mm256_mask_i64gather_ps(zero, base + l, a_lo, mask_lo, 1));
+        }
+
+        _mm256_storeu_ps(y, inp4ff__cubic_eval_avx2(x[0], x[1], x[2], x[3], fract));
+
+        for (l = 0; l < 8; ++l) {
+            *out[l] = y[l];
+            out[l] += step[l];
+        }
+
+        p_lo = _mm256_add_pd(p_lo, r_lo);
+        p_hi = _mm256_add_pd(p_hi, r_hi);
+    }
+
+    _mm256_storeu_pd(pos, p_lo);
+    _mm256_storeu_pd(pos + 4, p_hi);
+
+    for (l = 0; l < 8; ++l) {
+        if (!active[l]) out[l] = 0;
+    }
+}
+
+#endif /* INP4FF__USE_BATCH_VECTOR */
+
+/* Generates the indices and fractions of consecutive groups of 8 outputs.
+   Positions are accumulated serially exactly like in inp4ff__read_from_src
+   so that both paths see the same indices and the depletion logic of
+   inp4ff_process holds. Fixed point and indexed positions don't depend on the
+   previous one, and are computed in parallel instead. */
+typedef struct {
+    t_inp4ff_phase position;                        /* position of the next group, output count when indexed */
+    t_inp4ff_phase rate;
+#if defined(INP4FF_USE_FIXED_POS)
+    __m256i split;                                  /* integer parts to the low, fractions to the high lane */
+    __m256i step;
+    __m256i lo, hi;
+#elif defined(INP4FF_USE_INDEXED_POS)
+    __m256d rate_x4;
+    __m256d base;
+    __m256d count_lo, count_hi;
+#endif
+} inp4ff__avx2_stepper;
+
+static void inp4ff__avx2_stepper_init(inp4ff__avx2_stepper* st, const inp4ff* interp, t_inp4ff_phase pos, t_inp4ff_phase rate)
+{
+    (void)interp;
+
+    st->position = pos;
+    st->rate = rate;
+
+#if defined(INP4FF_USE_FIXED_POS)
+    st->split = _mm256_setr_epi32(1, 3, 5, 7, 0, 2, 4, 6);
+    st->step = _mm256_set1_epi64x(8 * rate);
+    st->lo = _mm256_setr_epi64x(pos, pos + rate, pos + 2 * rate, pos + 3 * rate);
+    st->hi = _mm256_add_epi64(st->lo, _mm256_set1_epi64x(4 * rate));
+#elif defined(INP4FF_USE_INDEXED_POS)
+    st->rate_x4 = _mm256_set1_pd(rate);
+    st->base = _mm256_set1_pd(interp->base);
+    st->count_lo = _mm256_add_pd(_mm256_set1_pd(pos), _mm256_setr_pd(0.0, 1.0, 2.0, 3.0));
+    st->count_hi = _mm256_add_pd(st->count_lo, _mm256_set1_pd(4.0));
+#endif
+}
+
+static void inp4ff__avx2_step(inp4ff__avx2_stepper* st, __m256i* index, __m256* fract)
+{
+#if defined(INP4FF_USE_FIXED_POS)
+
+    const __m256i parts_lo = _mm256_permutevar8x32_epi32(st->lo, st->split);
+    const __m256i parts_hi = _mm256_permutevar8x32_epi32(st->hi, st->split);
+
+    *index = _mm256_permute2x128_si256(parts_lo, parts_hi, 0x20);
+
+    /* see INP4FF_PHASE_FRACT */
+    *fract = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_permute2x128_si256(parts_lo, parts_hi, 0x31), 1)),
+                           _mm256_set1_ps((float)(2.0 / INP4FF_PHASE_SCALE)));
+
+    st->lo = _mm256_add_epi64(st->lo, st->step);
+    st->hi = _mm256_add_epi64(st->hi, st->step);
+    st->position += 8 * st->rate;
+
+#elif defined(INP4FF_USE_INDEXED_POS)
+
+    const __m256d vpos_lo = _mm256_mul_pd(st->count_lo, st->rate_x4);
+    const __m256d vpos_hi = _mm256_mul_pd(st->count_hi, st->rate_x4);
+    const __m256d vfloor_lo = _mm256_round_pd(vpos_lo, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    const __m256d vfloor_hi = _mm256_round_pd(vpos_hi, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+    *index = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(_mm256_add_pd(vfloor_lo, st->base))),
+                                     _mm256_cvttpd_epi32(_mm256_add_pd(vfloor_hi, st->base)), 1);
+    *fract = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_sub_pd(vpos_lo, vfloor_lo))),
+                                  _mm256_cvtpd_ps(_mm256_sub_pd(vpos_hi, vfloor_hi)), 1);
+
+    st->count_lo = _mm256_add_pd(st->count_lo, _mm256_set1_pd(8.0));
+    st->count_hi = _mm256_add_pd(st->count_hi, _mm256_set1_pd(8.0));
+    st->position += 8.0;
+
+#elif defined(INP4FF_USE_FLOAT32_POS)
+
+    int i;
+    float positions[8];
+    __m256 vpos;
+
+    for (i = 0; i < 8; ++i) {
+        positions[i] = st->position;
+        st->position += st->rate;
+    }
+
+    vpos = _mm256_loadu_ps(positions);
+    *index = _mm256_cvttps_epi32(vpos);
+    *fract = _mm256_sub_ps(vpos, _mm256_round_ps(vpos, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+
+#else
+
+    int i;
+    double positions[8];
+    __m256d vpos_lo, vpos_hi, vfloor_lo, vfloor_hi;
+
+    for (i = 0; i < 8; ++i) {
+        positions[i] = st->position;
+        st->position += st->rate;
+    }
+
+    vpos_lo = _mm256_loadu_pd(positions);
+    vpos_hi = _mm256_loadu_pd(positions + 4);
+    vfloor_lo = _mm256_round_pd(vpos_lo, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    vfloor_hi = _mm256_round_pd(vpos_hi, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+
+    *index = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(vpos_lo)),
+                                     _mm256_cvttpd_epi32(vpos_hi), 1);
+    *fract = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_sub_pd(vpos_lo, vfloor_lo))),
+                                  _mm256_cvtpd_ps(_mm256_sub_pd(vpos_hi, vfloor_hi)), 1);
+
+#endif
+}
+
+/* The cubic of inp4ff__cubic_interp_avx2 for 8 lanes whose taps all lie in
+   the 11 samples at window. offset holds the index of x[0] of each lane within
+   the window and must be at most 7. Tap k of every lane is then found in the
+   8 samples at window + k, and is picked with a single permute. */
+static __m256 inp4ff__cubic_interp_permute_avx2(const t_inp4ff_src* window, __m256i offset, __m256 fract)
+{
+    return inp4ff__cubic_eval_avx2(_mm256_permutevar8x32_ps(_mm256_loadu_ps(window), offset),
+                                   _mm256_permutevar8x32_ps(_mm256_loadu_ps(window + 1), offset),
+                                   _mm256_permutevar8x32_ps(_mm256_loadu_ps(window + 2), offset),
+                                   _mm256_permutevar8x32_ps(_mm256_loadu_ps(window + 3), offset),
+                                   fract);
+}
+
+/* Interpolates n / 8 groups of 8 samples from src and returns the number of
+   samples left for the scalar loop. */
+static int inp4ff__read_from_src_avx2(const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n)
+{
+    t_inp4ff_dst* d = *dst;
+    inp4ff__avx2_stepper st;
+    __m256i index;
+    __m256 fract;
+
+    inp4ff__avx2_stepper_init(&st, interp, *pos, rate);
+
+    while (n >= 8) {
+
+        inp4ff__avx2_step(&st, &index, &fract);
+        _mm256_storeu_ps(d, inp4ff__cubic_interp_avx2(src, index, fract));
+
+        d += 8;
+        n -= 8;
+    }
+
+    *pos = st.position;
+    *dst = d;
+
+    return n;
+}
+
+/* Groups of 8 output frames of inp4ff__read_frames, each frame stepped once
+   for all of its channels. The taps of a channel are nch samples apart. With
+   an even nch the channels are read as quads, 2 frames per vector, and the
+   pair left over 4 frames per vector. Stereo frames are 8 consecutive
+   samples and are transposed from whole loads. An odd nch is gathered, the
+   8 * nch outputs of a group 8 at a time in the order of dst: lane l of the
+   q-th 8 is channel (8q + l) % nch of frame (8q + l) / nch, its index and
+   fraction permuted out of those of the group. Returns the number of frames
+   left for the scalar loop. */
+static int inp4ff__read_frames_avx2(const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, int nch, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n)
+{
+    t_inp4ff_dst* d = *dst;
+    inp4ff__avx2_stepper st;
+    __m256i index, at;
+    __m256i frame [INP4FF_MAX_CHANNELS], channel [INP4FF_MAX_CHANNELS];
+    __m256 fract, f, y;
+    int c, q, l, lanes [8];
+
+    /* temps */
+    const t_inp4ff_src *a, *b, *e, *g;
+    __m256d t0, t1, t2, t3;
+    __m256 x [4];
+    t_inp4ff_dst* out;
+
+    for (q = 0; nch & 1 && q < nch; ++q) {
+
+        for (l = 0; l < 8; ++l) lanes[l] = (8 * q + l) / nch;
+        frame[q] = _mm256_loadu_si256((const __m256i*)lanes);
+
+        for (l = 0; l < 8; ++l) lanes[l] = (8 * q + l) % nch;
+        channel[q] = _mm256_loadu_si256((const __m256i*)lanes);
+    }
+
+    inp4ff__avx2_stepper_init(&st, interp, *pos, rate);
+
+    for (; n >= 8; n -= 8, d += 8 * nch) {
+
+        /* offset of the frame of tap x[1] */
+        inp4ff__avx2_step(&st, &index, &fract);
+        index = _mm256_mullo_epi32(index, _mm256_set1_epi32(nch));
+
+        if (nch & 1) {
+
+            for (q = 0; q < nch; ++q) {
+
+                at = _mm256_add_epi32(_mm256_permutevar8x32_epi32(index, frame[q]), channel[q]);
+                f = _mm256_permutevar8x32_ps(fract, frame[q]);
+
+                _mm256_storeu_ps(d + 8 * q, inp4ff__cubic_eval_avx2(_mm256_i32gather_ps(src - nch, at, 4),
+                                                                    _mm256_i32gather_ps(src, at, 4),
+                                                                    _mm256_i32gather_ps(src + nch, at, 4),
+                                                                    _mm256_i32gather_ps(src + 2 * nch, at, 4), f));
+            }
+            continue;
+        }
+
+        _mm256_storeu_si256((__m256i*)lanes, index);
+
+        for (c = 0; c + 4 <= nch; c += 4) {
+
+            for (q = 0; q < 8; q += 2) {
+
+                a = src + lanes[q] - nch + c;
+                b = src + lanes[q + 1] - nch + c;
+
+                f = _mm256_permutevar8x32_ps(fract, _mm256_add_epi32(_mm256_set1_epi32(q), _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1)));
+
+                y = inp4ff__cubic_eval_avx2(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a)), _mm_loadu_ps(b), 1),
+                                            _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + nch)), _mm_loadu_ps(b + nch), 1),
+                                            _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + 2 * nch)), _mm_loadu_ps(b + 2 * nch), 1),
+                                            _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + 3 * nch)), _mm_loadu_ps(b + 3 * nch), 1), f);
+
+                out = d + q * nch + c;
+                if (nch == 4) {
+                    _mm256_storeu_ps(out, y);
+                } else {
+                    _mm_storeu_ps(out, _mm256_castps256_ps128(y));
+                    _mm_storeu_ps(out + nch, _mm256_extractf128_ps(y, 1));
+                }
+            }
+        }
+
+        for (q = 0; c < nch && q < 8; q += 4) {
+
+            f = _mm256_permutevar8x32_ps(fract, _mm256_add_epi32(_mm256_set1_epi32(q), _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3)));
+
+            if (nch == 2) {
+
+                /* the taps of a frame as 4 doubles, one per stereo pair */
+                t0 = _mm256_castps_pd(_mm256_loadu_ps(src + lanes[q] - 2));
+                t1 = _mm256_castps_pd(_mm256_loadu_ps(src + lanes[q + 1] - 2));
+                t2 = _mm256_castps_pd(_mm256_loadu_ps(src + lanes[q + 2] - 2));
+                t3 = _mm256_castps_pd(_mm256_loadu_ps(src + lanes[q + 3] - 2));
+
+                _mm256_storeu_ps(d + 2 * q, inp4ff__cubic_eval_avx2(
+                    _mm256_castpd_ps(_mm256_permute2f128_pd(_mm256_unpacklo_pd(t0, t1), _mm256_unpacklo_pd(t2, t3), 0x20)),
+                    _mm256_castpd_ps(_mm256_permute2f128_pd(_mm256_unpackhi_pd(t0, t1), _mm256_unpackhi_pd(t2, t3), 0x20)),
+                    _mm256_castpd_ps(_mm256_permute2f128_pd(_mm256_unpacklo_pd(t0, t1), _mm256_unpacklo_pd(t2, t3), 0x31)),
+                    _mm256_castpd_ps(_mm256_permute2f128_pd(_mm256_unpackhi_pd(t0, t1), _mm256_unpackhi_pd(t2, t3), 0x31)), f));
+                continue;
+            }
+
+            a = src + lanes[q] - nch + c;
+            b = src + lanes[q + 1] - nch + c;
+            e = src + lanes[q + 2] - nch + c;
+            g = src + lanes[q + 3] - nch + c;
+
+            for (l = 0; l < 4; ++l) {
+                x[l] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(a + l * nch)), (const __m64*)(b + l * nch))),
+                                            _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(e + l * nch)), (const __m64*)(g + l * nch)), 1);
+            }
+
+            y = inp4ff__cubic_eval_avx2(x[0], x[1], x[2], x[3], f);
+
+            out = d + q * nch + c;
+            _mm_storel_pi((__m64*)out, _mm256_castps256_ps128(y));
+            _mm_storeh_pi((__m64*)(out + nch), _mm256_castps256_ps128(y));
+            _mm_storel_pi((__m64*)(out + 2 * nch), _mm256_extractf128_ps(y, 1));
+            _mm_storeh_pi((__m64*)(out + 3 * nch), _mm256_extractf128_ps(y, 1));
+        }
+    }
+
+    *pos = st.position;
+    *dst = d;
+
+    return n;
+}
+
+/* Groups of 8 outputs of inp4ff_delay_read, with the positions found in
+   vector registers as well. base is that of inp4ff_delay_read. Returns the
+   number of outputs written. */
+static int inp4ff__delay_read_avx2(const t_inp4ff_src* data, unsigned int mask, unsigned int base, t_inp4ff_dst* dst, const t_inp4ff_pos* delays, int n)
+{
+    const __m256i vmask = _mm256_set1_epi32((int)mask);
+    const __m256i vbase = _mm256_set1_epi32((int)base);
+    __m256i index;
+    __m256 fract;
+    int i;
+#ifdef INP4FF_USE_FLOAT32_POS
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 t, f;
+#else
+    const __m256d lane = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    __m256d t_lo, t_hi, f_lo, f_hi;
+#endif
+
+    for (i = 0; i + 8 <= n; i += 8) {
+
+#ifdef INP4FF_USE_FLOAT32_POS
+        t = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)i), lane), _mm256_loadu_ps(delays + i));
+        f = _mm256_floor_ps(t);
+        index = _mm256_cvttps_epi32(f);
+        fract = _mm256_sub_ps(t, f);
+#else
+        t_lo = _mm256_sub_pd(_mm256_add_pd(_mm256_set1_pd((double)i), lane), _mm256_loadu_pd(delays + i));
+        t_hi = _mm256_sub_pd(_mm256_add_pd(_mm256_set1_pd((double)(i + 4)), lane), _mm256_loadu_pd(delays + i + 4));
+        f_lo = _mm256_floor_pd(t_lo);
+        f_hi = _mm256_floor_pd(t_hi);
+        index = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(f_lo)), _mm256_cvttpd_epi32(f_hi), 1);
+        fract = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_sub_pd(t_lo, f_lo))),
+                                     _mm256_cvtpd_ps(_mm256_sub_pd(t_hi, f_hi)), 1);
+#endif
+
+        /* x0 of each lane, wrapped into the buffer */
+        index = _mm256_and_si256(_mm256_add_epi32(index, vbase), vmask);
+
+        _mm256_storeu_ps(dst + i, inp4ff__cubic_interp_avx2(data + 1, index, fract));
+    }
+
+    return i;
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+
+/* Groups of 8 outputs of inp4ff__read_varirate. The positions of a group are
+   stepped before any of it is read, and a group reaching past src is left to
+   the scalar loop. Returns the number of outputs left. */
+static int inp4ff__read_varirate_avx2(t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase* pos, const t_inp4ff_pos** rates, int n)
+{
+    t_inp4ff_phase p = *pos, q;
+    t_inp4ff_dst* d = *dst;
+    const t_inp4ff_pos* r = *rates;
+    int i;
+    int index [8];
+    float fract [8];
+
+    for (; n >= 8; n -= 8, d += 8, r += 8) {
+
+        q = p;
+
+        for (i = 0; i < 8; ++i) {
+#ifdef INP4FF_USE_FIXED_POS
+            index[i] = (int)(q >> 32);
+            fract[i] = (float)INP4FF_PHASE_FRACT(q);
+#else
+            index[i] = INP4FF_FLOOR_INT(q);
+            fract[i] = (float)(q - index[i]);
+#endif
+            q += inp4ff__phase_rate(r[i] > 0 ? r[i] : (t_inp4ff_pos)(0.0));
+        }
+
+        /* the positions don't decrease, the first and last lanes bound them */
+        if (index[0] < 1 || index[7] > nsrc - 3) break;
+
+        _mm256_storeu_ps(d, inp4ff__cubic_interp_avx2(src, _mm256_loadu_si256((const __m256i*)index), _mm256_loadu_ps(fract)));
+
+        p = q;
+    }
+
+    *pos = p;
+    *dst = d;
+    *rates = r;
+
+    return n;
+}
+
+#   ifndef INP4FF_USE_FLOAT32_POS
+
+/* Groups of 8 of the n outputs of inp4ff__read_ramp from pos on, all within
+   src. Each lane holds its position and its rate, and a group steps them by 8
+   outputs at once, the position by 8 times the rate and 28 steps and the
+   rate by 8 steps. In fixed point this is exact. Double positions may drift
+   from the closed form by a rounding, so the indices are kept within src.
+   Returns the number of outputs left. */
+static int inp4ff__read_ramp_avx2(t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase pos, t_inp4ff_phase rate, t_inp4ff_phase step, int n)
+{
+    t_inp4ff_dst* d = *dst;
+
+#ifdef INP4FF_USE_FIXED_POS
+    const __m256i split = _mm256_setr_epi32(1, 3, 5, 7, 0, 2, 4, 6);
+    const __m256i rate_step = _mm256_set1_epi64x(8 * step);
+    const __m256i pos_step = _mm256_set1_epi64x(28 * step);
+    __m256i p_lo = _mm256_setr_epi64x(pos, inp4ff__ramp_at(pos, rate, step, 1), inp4ff__ramp_at(pos, rate, step, 2), inp4ff__ramp_at(pos, rate, step, 3));
+    __m256i p_hi = _mm256_setr_epi64x(inp4ff__ramp_at(pos, rate, step, 4), inp4ff__ramp_at(pos, rate, step, 5),
+                                      inp4ff__ramp_at(pos, rate, step, 6), inp4ff__ramp_at(pos, rate, step, 7));
+    __m256i r_lo = _mm256_setr_epi64x(rate, rate + step, rate + 2 * step, rate + 3 * step);
+    __m256i r_hi = _mm256_add_epi64(r_lo, _mm256_set1_epi64x(4 * step));
+    __m256i parts_lo, parts_hi;
+#else
+    const __m256d eight = _mm256_set1_pd(8.0);
+    const __m256d rate_step = _mm256_set1_pd(8.0 * step);
+    const __m256d pos_step = _mm256_set1_pd(28.0 * step);
+    const __m256i last = _mm256_set1_epi32(nsrc - 3);
+    __m256d p_lo = _mm256_setr_pd(pos, inp4ff__ramp_at(pos, rate, step, 1), inp4ff__ramp_at(pos, rate, step, 2), inp4ff__ramp_at(pos, rate, step, 3));
+    __m256d p_hi = _mm256_setr_pd(inp4ff__ramp_at(pos, rate, step, 4), inp4ff__ramp_at(pos, rate, step, 5),
+                                  inp4ff__ramp_at(pos, rate, step, 6), inp4ff__ramp_at(pos, rate, step, 7));
+    __m256d r_lo = _mm256_setr_pd(rate, rate + step, rate + 2.0 * step, rate + 3.0 * step);
+    __m256d r_hi = _mm256_add_pd(r_lo, _mm256_set1_pd(4.0 * step));
+    __m256d f_lo, f_hi;
+#endif
+    __m256i index;
+    __m256 fract;
+
+    for (; n >= 8; n -= 8, d += 8) {
+
+#ifdef INP4FF_USE_FIXED_POS
+        /* see inp4ff__avx2_step */
+        parts_lo = _mm256_permutevar8x32_epi32(p_lo, split);
+        parts_hi = _mm256_permutevar8x32_epi32(p_hi, split);
+
+        index = _mm256_permute2x128_si256(parts_lo, parts_hi, 0x20);
+        fract = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_permute2x128_si256(parts_lo, parts_hi, 0x31), 1)),
+                              _mm256_set1_ps((float)(2.0 / INP4FF_PHASE_SCALE)));
+
+        p_lo = _mm256_add_epi64(p_lo, _mm256_add_epi64(_mm256_slli_epi64(r_lo, 3), pos_step));
+        p_hi = _mm256_add_epi64(p_hi, _mm256_add_epi64(_mm256_slli_epi64(r_hi, 3), pos_step));
+        r_lo = _mm256_add_epi64(r_lo, rate_step);
+        r_hi = _mm256_add_epi64(r_hi, rate_step);
+#else
+        f_lo = _mm256_round_pd(p_lo, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        f_hi = _mm256_round_pd(p_hi, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+        index = _mm256_min_epi32(_mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(f_lo)),
+                                                         _mm256_cvttpd_epi32(f_hi), 1), last);
+        fract = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_sub_pd(p_lo, f_lo))),
+                                     _mm256_cvtpd_ps(_mm256_sub_pd(p_hi, f_hi)), 1);
+
+        p_lo = _mm256_fmadd_pd(r_lo, eight, _mm256_add_pd(p_lo, pos_step));
+        p_hi = _mm256_fmadd_pd(r_hi, eight, _mm256_add_pd(p_hi, pos_step));
+        r_lo = _mm256_add_pd(r_lo, rate_step);
+        r_hi = _mm256_add_pd(r_hi, rate_step);
+#endif
+
+        _mm256_storeu_ps(d, inp4ff__cubic_interp_avx2(src, index, fract));
+    }
+
+    *dst = d;
+
+    return n;
+}
+
+#   endif
+
+#endif
+
+/* Version of inp4ff__read_from_src_avx2 for rate <= 1. The 8 outputs of a
+   group then span at most 11 consecutive samples, which are loaded as one
+   window and permuted to the taps of each lane. Groups too close to the end
+   of src to load the whole window fall back to gathering. */
+static int inp4ff__read_from_src_upsample_avx2(const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, int nsrc, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n)
+{
+    t_inp4ff_dst* d = *dst;
+    inp4ff__avx2_stepper st;
+    __m256i index, offset;
+    __m256 fract;
+    int first;
+
+    inp4ff__avx2_stepper_init(&st, interp, *pos, rate);
+
+    while (n >= 8) {
+
+        inp4ff__avx2_step(&st, &index, &fract);
+
+        /* the first lane has the lowest index, and the window starts at its x[0] */
+        first = _mm256_cvtsi256_si32(index) - 1;
+
+        if (first + 11 <= nsrc) {
+            offset = _mm256_sub_epi32(index, _mm256_set1_epi32(first + 1));
+            _mm256_storeu_ps(d, inp4ff__cubic_interp_permute_avx2(&src[first], offset, fract));
+        } else {
+            _mm256_storeu_ps(d, inp4ff__cubic_interp_avx2(src, index, fract));
+        }
+
+        d += 8;
+        n -= 8;
+    }
+
+    *pos = st.position;
+    *dst = d;
+
+    return n;
+}
+
+#endif /* INP4FF_USE_AVX2 */
+
+#if defined(INP4FF__USE_VECTOR) && defined(INP4FF_USE_AVX512)
+
+/* 16-wide version of inp4ff__cubic_interp, see inp4ff__cubic_interp_avx2 for
+   the precision. */
+static __m512 inp4ff__cubic_interp_avx512(const t_inp4ff_src* src, __m512i index, __m512 fract)
+{
+    const __m512 x0 = _mm512_i32gather_ps(index, src - 1, 4);
+    const __m512 x1 = _mm512_i32gather_ps(index, src, 4);
+    const __m512 x2 = _mm512_i32gather_ps(index, src + 1, 4);
+    const __m512 x3 = _mm512_i32gather_ps(index, src + 2, 4);
+
+    const __m512 three = _mm512_set1_ps(3.0f);
+    const __m512 x21_diff = _mm512_sub_ps(x2, x1);
+
+    const __m512 c = _mm512_fmadd_ps(_mm512_fnmadd_ps(three, x21_diff, _mm512_sub_ps(x3, x0)), fract,
+                                     _mm512_fnmadd_ps(three, x1, _mm512_fmadd_ps(_mm512_set1_ps(2.0f), x0, x3)));
+
+    const __m512 k = _mm512_mul_ps(_mm512_set1_ps(0.1666667f), _mm512_sub_ps(_mm512_set1_ps(1.0f), fract));
+
+    return _mm512_fmadd_ps(fract, _mm512_fnmadd_ps(k, c, x21_diff), x1);
+}
+
+/* Interpolates n / 16 groups of 16 samples from src and returns the number of
+   samples left over. */
+static int inp4ff__read_from_src_avx512(const inp4ff* interp, t_inp4ff_dst** dst, const t_inp4ff_src* src, t_inp4ff_phase* pos, t_inp4ff_phase rate, int n)
+{
+    t_inp4ff_phase p = *pos;
+    t_inp4ff_dst* d = *dst;
+    __m512i index;
+    __m512 fract;
+
+#if defined(INP4FF_USE_FIXED_POS)
+    const __m512i integers = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512i fractions = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i vstep = _mm512_set1_epi64(16 * rate);
+    __m512i vpos_lo = _mm512_setr_epi64(p, p + rate, p + 2 * rate, p + 3 * rate,
+                                        p + 4 * rate, p + 5 * rate, p + 6 * rate, p + 7 * rate);
+    __m512i vpos_hi = _mm512_add_epi64(vpos_lo, _mm512_set1_epi64(8 * rate));
+#elif defined(INP4FF_USE_INDEXED_POS)
+    const __m512d vrate = _mm512_set1_pd(rate);
+    const __m512d vbase = _mm512_set1_pd(interp->base);
+    __m512d vcount_lo = _mm512_add_pd(_mm512_set1_pd(p), _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+    __m512d vcount_hi = _mm512_add_pd(vcount_lo, _mm512_set1_pd(8.0));
+    __m512d vpos_lo, vpos_hi, vfloor_lo, vfloor_hi;
+#elif defined(INP4FF_USE_FLOAT32_POS)
+    int i;
+    __m512 vpos;
+    float positions[16];
+#else
+    int i;
+    __m512d vpos_lo, vpos_hi;
+    double positions[16];
+#endif
+
+    while (n >= 16) {
+
+#if defined(INP4FF_USE_FIXED_POS)
+        index = _mm512_permutex2var_epi32(vpos_lo, integers, vpos_hi);
+        fract = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(_mm512_permutex2var_epi32(vpos_lo, fractions, vpos_hi), 1)),
+                              _mm512_set1_ps((float)(2.0 / INP4FF_PHASE_SCALE)));
+
+        vpos_lo = _mm512_add_epi64(vpos_lo, vstep);
+        vpos_hi = _mm512_add_epi64(vpos_hi, vstep);
+        p += 16 * rate;
+#elif defined(INP4FF_USE_INDEXED_POS)
+        vpos_lo = _mm512_mul_pd(vcount_lo, vrate);
+        vpos_hi = _mm512_mul_pd(vcount_hi, vrate);
+        vfloor_lo = _mm512_roundscale_pd(vpos_lo, _MM_FROUND_TO_NEG_INF);
+        vfloor_hi = _mm512_roundscale_pd(vpos_hi, _MM_FROUND_TO_NEG_INF);
+
+        index = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(_mm512_add_pd(vfloor_lo, vbase))),
+                                   _mm512_cvttpd_epi32(_mm512_add_pd(vfloor_hi, vbase)), 1);
+        fract = _mm512_castpd_ps(_mm512_insertf64x4(
+                    _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(_mm512_sub_pd(vpos_lo, vfloor_lo)))),
+                    _mm256_castps_pd(_mm512_cvtpd_ps(_mm512_sub_pd(vpos_hi, vfloor_hi))), 1));
+
+        vcount_lo = _mm512_add_pd(vcount_lo, _mm512_set1_pd(16.0));
+        vcount_hi = _mm512_add_pd(vcount_hi, _mm512_set1_pd(16.0));
+        p += 16.0;
+#elif defined(INP4FF_USE_FLOAT32_POS)
+        for (i = 0; i < 16; ++i) {
+            positions[i] = p;
+            p += rate;
+        }
+
+        vpos = _mm512_loadu_ps(positions);
+        index = _mm512_cvttps_epi32(vpos);
+        fract = _mm512_sub_ps(vpos, _mm512_roundscale_ps(vpos, _MM_FROUND_TO_ZERO));
+#else
+        for (i = 0; i < 16; ++i) {
+            positions[i] = p;
+            p += rate;
+        }
+
+        vpos_lo = _mm512_loadu_pd(positions);
+        vpos_hi = _mm512_loadu_pd(positions + 8);
+
+        index = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(vpos_lo)),
+                                   _mm512_cvttpd_epi32(vpos_hi), 1);
+        fract = _mm512_castpd_ps(_mm512_insertf64x4(
+                    _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(_mm512_sub_pd(vpos_lo, _mm512_roundscale_pd(vpos_lo, _MM_FROUND_TO_ZERO))))),
+                    _mm256_castps_pd(_mm512_cvtpd_ps(_mm512_sub_pd(vpos_hi, _mm512_roundscale_pd(vpos_hi, _MM_FROUND_TO_ZERO)))), 1));
+#endif
+
+        _mm512_storeu_ps(d, inp4ff__cubic_interp_avx512(src, index, fract));
+
+        d += 16;
+        n -= 16;
+    }
+
+    *pos = p;
+    *dst = d;
+
+    return n;
 }
 
+#endif /* INP4FF_USE_AVX512 */
 
 #endif /* INP4FF_H */ 
@@ -0,0 +1,70 @@
+/******************************************************************************
+inp4lib.h
+
+Copyright 2023 Olli Erik Keskinen
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+#ifndef INP4LIB_H
+#define INP4LIB_H
+
+/* Compiled counterpart of the header-only API. The library builds the process
+   functions of every variant once per instruction set (SSE2, AVX2+FMA and
+   AVX-512) and picks the best one supported by the CPU on first use.
+
+   The interpolator structs are shared with the headers, so the same state can
+   be used with both the header-only and the library functions. The library is
+   built with the default position types, so the options changing the struct
+   layout can't be used with it. */
+
+#if defined(INP4FF_USE_FLOAT32_POS) || defined(INP4FF_USE_FIXED_POS) || defined(INP4FF_USE_INDEXED_POS) \
+    || defined(INP4FF_USE_COEFFS)
+#   error "inp4lib is built with the default inp4ff position type"
+#endif
+
+#include "inp4ff.h"
+#include "inp4fd.h"
+#include "inp4df.h"
+#include "inp4dd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void inp4lib_ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate);
+void inp4lib_fd_process(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate);
+void inp4lib_df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate);
+void inp4lib_dd_process(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate);
+
+/* Selects the kernels if not done yet, and returns the name of the selected
+   instruction set: "avx512", "avx2", "sse2" or "generic". */
+const char* inp4lib_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INP4LIB_H */
@@ -0,0 +1,166 @@
+/******************************************************************************
+inp4lut.h
+
+Copyright 2023 Olli Erik Keskinen
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+#ifndef INP4LUT_H
+#define INP4LUT_H
+
+/* Shared coefficient table for the INP4xx_USE_LUT modes. The fraction of a
+   position gets rounded to one of INP4_LUT_PHASES phases, and the phase
+   selects the precomputed weights of the four taps, turning the cubic into a
+   dot product.
+
+   There's one table per process, shared by all interpolators of all variants.
+   Define INP4_LUT_IMPLEMENTATION in exactly one translation unit before
+   including any of the headers to place the table there. The table is built
+   by inp4_lut_init, which the create and init functions call. The first call
+   builds it and publishes it through inp4_lut_ready, calls racing with it
+   wait for the table to be ready. Calling it once at startup keeps the build
+   out of the audio thread. */
+
+#include <math.h>
+
+/* Atomics publishing the table, with acquire loads and release stores */
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#   define INP4__LUT_LOAD(p)            _InterlockedOr((volatile long*)(p), 0)
+#   define INP4__LUT_STORE(p, v)        _InterlockedExchange((volatile long*)(p), (long)(v))
+#   define INP4__LUT_CAS(p, old, new)   (_InterlockedCompareExchange((volatile long*)(p), (long)(new), (long)(old)) == (long)(old))
+#elif defined(__GNUC__)
+#   define INP4__LUT_LOAD(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#   define INP4__LUT_STORE(p, v)        __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#   define INP4__LUT_CAS(p, old, new)   __sync_bool_compare_and_swap((p), (old), (new))
+#else
+#   error "the shared table of the LUT modes needs atomics, see inp4_lut_init"
+#endif
+
+#ifndef INP4_LUT_PHASES
+#   define INP4_LUT_PHASES 1024
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Weights of x[0] ... x[3] for fractions 0, 1 / INP4_LUT_PHASES, ..., 1 */
+extern float inp4_lut [(INP4_LUT_PHASES + 1) * 4];
+extern int inp4_lut_ready;                          /* 0 unbuilt, 1 being built, 2 ready */
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef INP4_LUT_IMPLEMENTATION
+float inp4_lut [(INP4_LUT_PHASES + 1) * 4];
+int inp4_lut_ready = 0;
+#endif
+
+
+static void     inp4_lut_init           (void);
+static double   inp4_lut_error_db       (int num_phases);
+static void     inp4__lut_weights       (double fract, double* w);
+
+/* Builds the shared table if it hasn't been built yet. Only one caller
+   builds it, the others return once it's ready. */
+static void inp4_lut_init(void)
+{
+    int i, j;
+    double w[4];
+
+    if (INP4__LUT_LOAD(&inp4_lut_ready) == 2) return;
+
+    if (!INP4__LUT_CAS(&inp4_lut_ready, 0, 1)) {
+
+        /* built by another thread */
+        while (INP4__LUT_LOAD(&inp4_lut_ready) != 2) {
+        }
+        return;
+    }
+
+    for (i = 0; i <= INP4_LUT_PHASES; ++i) {
+
+        inp4__lut_weights((double)i / INP4_LUT_PHASES, w);
+
+        for (j = 0; j < 4; ++j) {
+            inp4_lut[i * 4 + j] = (float)w[j];
+        }
+    }
+
+    INP4__LUT_STORE(&inp4_lut_ready, 2);
+}
+
+/* Worst case error of a table with num_phases phases in dB relative to full
+   scale, i.e. for taps in range [-1, 1]. Doesn't need the table. */
+static double inp4_lut_error_db(int num_phases)
+{
+    int i, k;
+    double fract, error, max_error = 0.0;
+    double w[4], wq[4];
+
+    /* sample every phase step densely, rounding error peaks halfway between
+       phases, which the samples include */
+    for (i = 0; i <= num_phases * 16; ++i) {
+
+        fract = (double)i / (num_phases * 16);
+
+        inp4__lut_weights(fract, w);
+        inp4__lut_weights(floor(fract * num_phases + 0.5) / num_phases, wq);
+
+        error = 0.0;
+        for (k = 0; k < 4; ++k) {
+            error += fabs(w[k] - wq[k]);
+        }
+
+        if (error > max_error) max_error = error;
+    }
+
+    return 20.0 * log10(max_error);
+}
+
+/* Weights of the four taps of the cubic of inp4xx__cubic_interp. The cubic is
+   linear in the taps, so each weight is the response to a unit tap. */
+static void inp4__lut_weights(double fract, double* w)
+{
+    const double k = (float)(0.1666667);
+    int i;
+    double x[4], x21_diff, c;
+
+    for (i = 0; i < 4; ++i) {
+
+        x[0] = x[1] = x[2] = x[3] = 0.0;
+        x[i] = 1.0;
+
+        x21_diff = x[2] - x[1];
+        c = (x[3] - x[0] - 3.0 * x21_diff) * fract + (x[3] + 2.0 * x[0] - 3.0 * x[1]);
+
+        w[i] = x[1] + fract * (x21_diff - k * (1.0 - fract) * c);
+    }
+}
+
+#endif /* INP4LUT_H */
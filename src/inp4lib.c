@@ -0,0 +1,209 @@
+/******************************************************************************
+inp4lib.c
+
+Copyright 2023 Olli Erik Keskinen
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+/* Runtime selection of the process kernels. The function pointers start out
+   pointing to resolvers that query the CPU, store the best kernels and then
+   forward the call, so the detection runs only once. Concurrent first calls
+   may all run the detection but they'll store the same pointers. */
+
+#include "inp4lib_kernels.h"
+
+#if defined(INP4LIB_HAVE_X86_KERNELS) && defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+typedef enum {
+    Inp4LibIsa_Unresolved = 0,
+    Inp4LibIsa_Sse2,
+    Inp4LibIsa_Avx2,
+    Inp4LibIsa_Avx512,
+} Inp4LibIsa;
+
+static Inp4LibIsa inp4lib__isa = Inp4LibIsa_Unresolved;
+
+static void inp4lib__resolve(void);
+
+static void inp4lib__ff_resolve(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate);
+static void inp4lib__fd_resolve(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate);
+static void inp4lib__df_resolve(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate);
+static void inp4lib__dd_resolve(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate);
+
+static void (*inp4lib__ff_process)(inp4ff*, t_inp4ff_dst*, int, const t_inp4ff_src*, int, t_inp4ff_pos) = inp4lib__ff_resolve;
+static void (*inp4lib__fd_process)(inp4fd*, t_inp4fd_dst*, int, const t_inp4fd_src*, int, t_inp4fd_pos) = inp4lib__fd_resolve;
+static void (*inp4lib__df_process)(inp4df*, t_inp4df_dst*, int, const t_inp4df_src*, int, t_inp4df_pos) = inp4lib__df_resolve;
+static void (*inp4lib__dd_process)(inp4dd*, t_inp4dd_dst*, int, const t_inp4dd_src*, int, t_inp4dd_pos) = inp4lib__dd_resolve;
+
+
+#ifdef INP4LIB_HAVE_X86_KERNELS
+
+#ifdef _MSC_VER
+
+static int inp4lib__os_saves(unsigned long long mask)
+{
+    int info[4];
+
+    /* OSXSAVE */
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27))) return 0;
+
+    return (_xgetbv(0) & mask) == mask;
+}
+
+static int inp4lib__has_avx2(void)
+{
+    int info[4];
+    int fma;
+
+    __cpuid(info, 1);
+    fma = (info[2] & (1 << 12)) != 0;
+    __cpuidex(info, 7, 0);
+
+    /* XMM and YMM state */
+    return fma && (info[1] & (1 << 5)) && inp4lib__os_saves(0x6);
+}
+
+static int inp4lib__has_avx512(void)
+{
+    int info[4];
+
+    __cpuidex(info, 7, 0);
+
+    /* AVX512F, and opmask, ZMM and upper ZMM state on top of AVX2 */
+    return inp4lib__has_avx2() && (info[1] & (1 << 16)) && inp4lib__os_saves(0xe6);
+}
+
+#else
+
+static int inp4lib__has_avx2(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static int inp4lib__has_avx512(void)
+{
+    __builtin_cpu_init();
+    return inp4lib__has_avx2() && __builtin_cpu_supports("avx512f");
+}
+
+#endif /* _MSC_VER */
+
+#endif /* INP4LIB_HAVE_X86_KERNELS */
+
+
+static void inp4lib__resolve(void)
+{
+#ifdef INP4LIB_HAVE_X86_KERNELS
+    if (inp4lib__has_avx512()) {
+        inp4lib__ff_process = inp4lib__ff_process_avx512;
+        inp4lib__fd_process = inp4lib__fd_process_avx512;
+        inp4lib__df_process = inp4lib__df_process_avx512;
+        inp4lib__dd_process = inp4lib__dd_process_avx512;
+        inp4lib__isa = Inp4LibIsa_Avx512;
+        return;
+    }
+
+    if (inp4lib__has_avx2()) {
+        inp4lib__ff_process = inp4lib__ff_process_avx2;
+        inp4lib__fd_process = inp4lib__fd_process_avx2;
+        inp4lib__df_process = inp4lib__df_process_avx2;
+        inp4lib__dd_process = inp4lib__dd_process_avx2;
+        inp4lib__isa = Inp4LibIsa_Avx2;
+        return;
+    }
+#endif
+
+    inp4lib__ff_process = inp4lib__ff_process_sse2;
+    inp4lib__fd_process = inp4lib__fd_process_sse2;
+    inp4lib__df_process = inp4lib__df_process_sse2;
+    inp4lib__dd_process = inp4lib__dd_process_sse2;
+    inp4lib__isa = Inp4LibIsa_Sse2;
+}
+
+static void inp4lib__ff_resolve(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+{
+    inp4lib__resolve();
+    inp4lib__ff_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+static void inp4lib__fd_resolve(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate)
+{
+    inp4lib__resolve();
+    inp4lib__fd_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+static void inp4lib__df_resolve(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate)
+{
+    inp4lib__resolve();
+    inp4lib__df_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+static void inp4lib__dd_resolve(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate)
+{
+    inp4lib__resolve();
+    inp4lib__dd_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+
+void inp4lib_ff_process(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+{
+    inp4lib__ff_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void inp4lib_fd_process(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate)
+{
+    inp4lib__fd_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void inp4lib_df_process(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate)
+{
+    inp4lib__df_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void inp4lib_dd_process(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate)
+{
+    inp4lib__dd_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+const char* inp4lib_isa(void)
+{
+    if (inp4lib__isa == Inp4LibIsa_Unresolved) {
+        inp4lib__resolve();
+    }
+
+    switch (inp4lib__isa) {
+        case Inp4LibIsa_Avx512: return "avx512";
+        case Inp4LibIsa_Avx2:   return "avx2";
+#ifdef INP4LIB_HAVE_X86_KERNELS
+        case Inp4LibIsa_Sse2:   return "sse2";
+#endif
+        default:                return "generic";
+    }
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+inp4lib_kernels.c
+
+Copyright 2023 Olli Erik Keskinen
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+******************************************************************************/
+
+/* Compiled once per instruction set, with INP4LIB_AVX512, INP4LIB_AVX2 or
+   neither defined. Each build exports its process functions with the
+   instruction set as a suffix, inp4lib.c picks between them at runtime. */
+
+#if defined(INP4LIB_AVX512)
+#   define INP4FF_USE_AVX512
+#   define INP4FF_USE_AVX2
+#   define INP4LIB_KERNEL(name) name##_avx512
+#elif defined(INP4LIB_AVX2)
+#   define INP4FF_USE_AVX2
+#   define INP4LIB_KERNEL(name) name##_avx2
+#else
+#   define INP4LIB_KERNEL(name) name##_sse2
+#endif
+
+#include "inp4lib_kernels.h"
+
+void INP4LIB_KERNEL(inp4lib__ff_process)(inp4ff* interp, t_inp4ff_dst* dst, int ndst, const t_inp4ff_src* src, int nsrc, t_inp4ff_pos rate)
+{
+    inp4ff_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void INP4LIB_KERNEL(inp4lib__fd_process)(inp4fd* interp, t_inp4fd_dst* dst, int ndst, const t_inp4fd_src* src, int nsrc, t_inp4fd_pos rate)
+{
+    inp4fd_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void INP4LIB_KERNEL(inp4lib__df_process)(inp4df* interp, t_inp4df_dst* dst, int ndst, const t_inp4df_src* src, int nsrc, t_inp4df_pos rate)
+{
+    inp4df_process(interp, dst, ndst, src, nsrc, rate);
+}
+
+void INP4LIB_KERNEL(inp4lib__dd_process)(inp4dd* interp, t_inp4dd_dst* dst, int ndst, const t_inp4dd_src* src, int nsrc, t_inp4dd_pos rate)
+{
+    inp4dd_process(interp, dst, ndst, src, nsrc, rate);
+}
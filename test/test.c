@@ -1,7 +1,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+
+#ifdef INP4FF_USE_LUT
+#   define INP4_LUT_IMPLEMENTATION
+#endif
 #include <inp4ff.h>
+#include <inp4cf.h>
+
+/* the library is built with the default inp4ff struct and cubic */
+#if !defined(INP4FF_USE_FLOAT32_POS) && !defined(INP4FF_USE_FIXED_POS) && !defined(INP4FF_USE_INDEXED_POS) \
+    && !defined(INP4FF_USE_COEFFS) && !defined(INP4FF_USE_LUT)
+#   define TEST_LIBRARY
+#   include <inp4lib.h>
+#endif
 
 #define EPSILON_CMP(a, b) (fabs(a - b) > 1e-5)
 
@@ -183,7 +195,7 @@ int drift_test(int nsrc, float rate)
     inp4ff seg_interp = inp4ff_create(ndst, 0);
     inp4ff lin_interp = inp4ff_create(ndst, 0);
 
-    for (i = 0; i < ndst; ++i)
+    for (i = 0; i < nsrc; ++i)
     {
         src[i] = i+1;
     }
@@ -192,7 +204,7 @@ int drift_test(int nsrc, float rate)
     do {
         for (i = 0; i < 8; ++i)
         {
-            srcseg[i] = src[isrc];
+            srcseg[i] = isrc < nsrc ? src[isrc] : 0.0f;
             isrc++;
         }
         inp4ff_process(&seg_interp, lindst, ndst, srcseg, 8, rate);
@@ -212,19 +224,1963 @@ int drift_test(int nsrc, float rate)
     return 0;
 }
 
-int main()
+/** The scalar cubic of inp4ff.h, as evaluated without the vector kernels */
+float reference_cubic(const float* x, t_inp4ff_pos fract)
 {
-#if 0
-    float rate = 0.1;
-    
-    naive_test(32);
-    
-    //while (rate < 8)
+    const float x21_diff = x[2] - x[1];
+    const float c = (x[3] - x[0] - 3.0f * x21_diff) * fract + (x[3] + 2.0f * x[0] - 3.0f * x[1]);
+
+    return (float)(x[1] + fract * (x21_diff - 0.1666667f * (1.0f - fract) * c));
+}
+
+/**
+ Largest difference expected from reference_cubic with taps in range [-1, 1]
+ */
+double cubic_tolerance()
+{
+#ifdef INP4FF_USE_LUT
+    return pow(10.0, inp4_lut_error_db(INP4_LUT_PHASES) / 20.0) + 4.0 * 1.1920929e-7;
+#else
+    return 4.0 * 1.1920929e-7;
+#endif
+}
+
+/**
+ Compares inp4ff_process against the scalar cubic evaluated on a linear copy
+ of src. With INP4FF_USE_AVX2 the vectorised kernel is expected to stay within
+ 4 ulp of 1.0 from the scalar path, otherwise the results should be exact.
+ With INP4FF_USE_LUT the error may reach the quantization error of the table.
+ */
+int simd_test(int ndst, float rate)
+{
+    int i, ipos, num_errors = 0;
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    double max_error = 0.0, error;
+#ifdef INP4FF_USE_FIXED_POS
+    t_inp4ff_phase pos = 0, phase_rate = (t_inp4ff_phase)(rate * INP4FF_PHASE_SCALE + 0.5);
+#else
+    t_inp4ff_pos pos = 0.0;
+#endif
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    float ref;
+    const double tolerance = cubic_tolerance();
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* src[0] is the initial state of the interpolator */
+    srand(2);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
     {
-        segmented_rw_test(4096, rate);
-        rate += 0.1;
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
     }
+
+    inp4ff_process(&interp, dst, ndst, src + 1, nsrc, rate);
+
+    for (i = 0; i < ndst; ++i)
+    {
+#if defined(INP4FF_USE_FIXED_POS)
+        ipos = (int)(pos >> 32);
+        ref = reference_cubic(&src[ipos], INP4FF_PHASE_FRACT(pos));
+        pos += phase_rate;
+#elif defined(INP4FF_USE_INDEXED_POS)
+        pos = i * (t_inp4ff_pos)rate;
+        ipos = (int)pos;
+        ref = reference_cubic(&src[ipos], pos - ipos);
+#else
+        ipos = (int)pos;
+        ref = reference_cubic(&src[ipos], pos - ipos);
+        pos += rate;
 #endif
-    //linear_drift_test(512, 0.1);
-    drift_test(512, 0.1);
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("SIMD test (rate %f) done, max error %g, %i errors encountered.\n", rate, max_error, num_errors);
+
+    free(src); free(dst);
+
+    return num_errors;
+}
+
+#if defined(INP4FF_USE_FIXED_POS) || defined(INP4FF_USE_INDEXED_POS)
+/**
+ With fixed point or indexed positions, segmented processing has to give
+ bit-identical results to processing the whole buffer at once. The positions
+ still are with INP4FF_USE_AVX2, but an output may then be computed in single
+ precision by a vector kernel on one side and by the scalar cubic on the
+ other, so the outputs are only required to agree within cubic_tolerance.
+ */
+int exact_segmented_test(int ndst, float rate)
+{
+    int i, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+#if defined(INP4FF_USE_AVX2) || defined(INP4FF_USE_AVX512)
+    const double tolerance = cubic_tolerance();
+#else
+    const double tolerance = 0.0;
+#endif
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst);
+    float* seg_dst = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+    inp4ff seg_interp = inp4ff_create(ndst, 0);
+
+    srand(4);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    inp4ff_process(&ref_interp, ref_dst, ndst, src, nsrc, rate);
+
+    /* both src and dst split to segments of random lengths in range [1, 7] */
+    nseg = 0; ndstseg = 0;
+    do {
+        if (seg_interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 7 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (seg_interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 7 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4ff_process(&seg_interp, seg_dst + idst, ndstseg, src + isrc, nseg, rate);
+
+    } while (seg_interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        if (fabs(ref_dst[i] - seg_dst[i]) > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f\n", i, ref_dst[i], seg_dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Exact segmented test (rate %f) done, %i errors encountered.\n", rate, num_errors);
+
+    free(src); free(ref_dst); free(seg_dst);
+
+    return num_errors;
+}
+#endif
+
+/**
+ At whole rates the outputs are copies of src. Processes the first half of dst
+ at rate and the second half at 0.5 with random segmentation, and compares
+ against src and the scalar cubic.
+ */
+int passthrough_test(int ndst, int rate)
+{
+    int i, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = ndst * rate + 4;
+    double pos = 0.0, seg_rate = rate, error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    double* rates = (double*)malloc(sizeof(double) * ndst);
+    float ref;
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* src[0] is the initial state of the interpolator */
+    srand(6);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* both src and dst split to segments of random lengths, the rate changes
+       between dst segments only */
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+            seg_rate = idst < ndst / 2 ? rate : 0.5;
+            for (i = 0; i < ndstseg; ++i) rates[idst + i] = seg_rate;
+        }
+
+        inp4ff_process(&interp, dst + idst, ndstseg, src + 1 + isrc, nseg, (t_inp4ff_pos)seg_rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ref = reference_cubic(&src[(int)pos], pos - (int)pos);
+
+        if (pos == (int)pos ? dst[i] != src[(int)pos + 1] : fabs(ref - dst[i]) > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+
+        pos += rates[i];
+    }
+
+    printf("Passthrough test (rate %i) done, max error %g, %i errors encountered.\n", rate, max_error, num_errors);
+
+    free(src); free(dst); free(rates);
+
+    return num_errors;
+}
+
+/**
+ Changes the rate at every dst segment, going on over many src segments, and
+ compares against the scalar cubic at the positions accumulated from the
+ rates. With indexed positions each change re-anchors the output count.
+ */
+int rate_change_test(int ndst)
+{
+    int i, ipos, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = ndst * 3 + 4;
+    double error, max_error = 0.0;
+    t_inp4ff_pos pos = 0, seg_rate = 1;
+#ifdef INP4FF_USE_FIXED_POS
+    /* the rates are rounded to 2^-32 */
+    const double tolerance = cubic_tolerance() + 1e-5;
+#else
+    const double tolerance = cubic_tolerance();
+#endif
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * ndst);
+    float ref;
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* src[0] is the initial state of the interpolator */
+    srand(61);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* the first quarter at rate 1 over src segments of 64, then a new rate
+       between 0.25 and 3 for each dst segment */
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+#ifdef INP4FF_USE_FLOAT32_POS
+            /* float positions drift with the segmentation of src */
+            nseg = nsrc - isrc;
+#else
+            nseg = 64;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+#endif
+        }
+
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = idst < ndst / 4 ? 64 : rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+            seg_rate = idst < ndst / 4 ? 1 : (t_inp4ff_pos)(0.25 + 2.75 * rand() / RAND_MAX);
+            for (i = 0; i < ndstseg; ++i) rates[idst + i] = seg_rate;
+        }
+
+        inp4ff_process(&interp, dst + idst, ndstseg, src + 1 + isrc, nseg, seg_rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ipos = (int)pos;
+        ref = reference_cubic(&src[ipos], pos - ipos);
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+
+        pos += rates[i];
+    }
+
+    printf("Rate change test done, max error %g, %i errors encountered.\n", max_error, num_errors);
+
+    free(src); free(dst); free(rates);
+
+    return num_errors;
+}
+
+/**
+ Compares inp4ff_process_ratio against the scalar cubic at the exact positions
+ k * down / up, and processing in one go against segmented processing, which
+ has to give bit-identical results.
+ */
+int ratio_test(int ndst, int up, int down)
+{
+    int i, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = (int)(((long long)ndst * down) / up) + 4;
+    long long pos;
+    double max_error = 0.0, error;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst);
+    float* seg_dst = (float*)malloc(sizeof(float) * ndst);
+    float ref;
+    inp4ff_ratio* ratio = (inp4ff_ratio*)malloc(sizeof(inp4ff_ratio));
+    inp4ff ref_interp, seg_interp;
+
+    if (!inp4ff_ratio_init(ratio, up, down))
+    {
+        printf("ERROR period of %i / %i doesn't fit\n", down, up);
+        free(src); free(ref_dst); free(seg_dst); free(ratio);
+        return 1;
+    }
+
+    ref_interp = inp4ff_create_ratio(ndst, 0, ratio);
+    seg_interp = inp4ff_create_ratio(ndst, 0, ratio);
+
+    /* src[0] is the initial state of the interpolator */
+    srand(5);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    inp4ff_process_ratio(&ref_interp, ref_dst, ndst, src + 1, nsrc);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        pos = (long long)i * ratio->down;
+        ref = reference_cubic(&src[pos / ratio->up], (t_inp4ff_pos)(pos % ratio->up) / ratio->up);
+
+        error = fabs(ref - ref_dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, ref_dst[i], ref - ref_dst[i]);
+            num_errors++;
+        }
+    }
+
+    /* both src and dst split to segments of random lengths in range [1, 7] */
+    nseg = 0; ndstseg = 0;
+    do {
+        if (seg_interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 7 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (seg_interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 7 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4ff_process_ratio(&seg_interp, seg_dst + idst, ndstseg, src + 1 + isrc, nseg);
+
+    } while (seg_interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        if (ref_dst[i] != seg_dst[i])
+        {
+            printf("ERROR %i %.20f %.20f\n", i, ref_dst[i], seg_dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Ratio test (%i / %i) done, max error %g, %i errors encountered.\n", down, up, max_error, num_errors);
+
+    free(src); free(ref_dst); free(seg_dst); free(ratio);
+
+    return num_errors;
+}
+
+/**
+ Multichannel test: nch interleaved or planar channels processed with a shared
+ position against each channel processed on its own, with the same random
+ segments.
+ */
+int multichannel_test(int ndst, int nch, float rate, int planar)
+{
+    int i, c, nseg, ndstseg, isrc, idst, num_errors = 0;
+    int nsrc = (int)(ndst * rate) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc * nch);
+    float* dst = (float*)malloc(sizeof(float) * ndst * nch);
+    float* ch_src = (float*)malloc(sizeof(float) * nsrc);
+    float* ch_dst = (float*)malloc(sizeof(float) * ndst);
+    int* segs = (int*)malloc(sizeof(int) * 2 * (nsrc + ndst));
+    int num_segs = 0;
+    const float* src_ch [INP4FF_MAX_CHANNELS];
+    float* dst_ch [INP4FF_MAX_CHANNELS];
+    inp4ff interp;
+
+    inp4ff_multi multi = inp4ff_multi_create(ndst, 0);
+
+    srand(11);
+    for (i = 0; i < nsrc * nch; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    /* record the segments so that every channel can be replayed with them */
+    isrc = 0; idst = 0; nseg = 0; ndstseg = 0;
+    do {
+        if (multi.interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (multi.interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        segs[num_segs++] = nseg;
+        segs[num_segs++] = ndstseg;
+
+        if (planar)
+        {
+            for (c = 0; c < nch; ++c)
+            {
+                src_ch[c] = src + c * nsrc + isrc;
+                dst_ch[c] = dst + c * ndst + idst;
+            }
+            inp4ff_process_planar(&multi, dst_ch, ndstseg, src_ch, nseg, nch, rate);
+        }
+        else
+        {
+            inp4ff_process_interleaved(&multi, dst + idst * nch, ndstseg, src + isrc * nch, nseg, nch, rate);
+        }
+
+    } while (multi.interp.state != Inp4State_Done);
+
+    for (c = 0; c < nch; ++c)
+    {
+        for (i = 0; i < nsrc; ++i) ch_src[i] = planar ? src[c * nsrc + i] : src[i * nch + c];
+
+        interp = inp4ff_create(ndst, 0);
+        isrc = 0; idst = 0; nseg = 0; ndstseg = 0;
+
+        for (i = 0; i < num_segs; i += 2)
+        {
+            if (interp.state != Inp4State_DstDepleted) isrc += nseg;
+            if (interp.state != Inp4State_SrcDepleted) idst += ndstseg;
+            nseg = segs[i];
+            ndstseg = segs[i + 1];
+
+            inp4ff_process(&interp, ch_dst + idst, ndstseg, ch_src + isrc, nseg, rate);
+        }
+
+        for (i = 0; i < ndst; ++i)
+        {
+            float value = planar ? dst[c * ndst + i] : dst[i * nch + c];
+
+            error = fabs(ch_dst[i] - value);
+            if (error > tolerance)
+            {
+                printf("ERROR %i %i %.20f %.20f\n", c, i, ch_dst[i], value);
+                num_errors++;
+            }
+            if (error > max_error) max_error = error;
+        }
+    }
+
+    printf("%s test (%i channels, rate %f) done, max error %g, %i errors encountered.\n",
+           planar ? "Planar" : "Interleaved", nch, rate, max_error, num_errors);
+
+    free(src); free(dst); free(ch_src); free(ch_dst); free(segs);
+
+    return num_errors;
+}
+
+/**
+ Processes one channel out of an interleaved src into an interleaved dst with
+ random segmentation, against inp4ff_process on the channel copied out, and
+ checks that the other samples of dst stay untouched.
+ */
+int strided_test(int ndst, int src_stride, int dst_stride, float rate)
+{
+    int i, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = (int)(ndst * rate) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc * src_stride);
+    float* dst = (float*)malloc(sizeof(float) * ndst * dst_stride);
+    float* ch_src = (float*)malloc(sizeof(float) * nsrc);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+
+    srand(13);
+    for (i = 0; i < nsrc * src_stride; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (i = 0; i < nsrc; ++i)
+    {
+        ch_src[i] = src[i * src_stride];
+    }
+    for (i = 0; i < ndst * dst_stride; ++i)
+    {
+        dst[i] = 100.0f;
+    }
+
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4ff_process_strided(&interp, dst + idst * dst_stride, ndstseg, dst_stride,
+                               src + isrc * src_stride, nseg, src_stride, rate);
+        inp4ff_process(&ref_interp, ref_dst + idst, ndstseg, ch_src + isrc, nseg, rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst * dst_stride; ++i)
+    {
+        if (i % dst_stride == 0)
+        {
+            error = fabs(ref_dst[i / dst_stride] - dst[i]);
+            if (error > max_error) max_error = error;
+        }
+        else
+        {
+            error = dst[i] == 100.0f ? 0.0 : 1.0;
+        }
+
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f\n", i, dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Strided test (src stride %i, dst stride %i, rate %f) done, max error %g, %i errors encountered.\n",
+           src_stride, dst_stride, rate, max_error, num_errors);
+
+    free(src); free(dst); free(ch_src); free(ref_dst);
+
+    return num_errors;
+}
+
+/**
+ Runs a batch of voices with their own rates, lengths and random segments
+ against a single state per voice fed the same segments. Lanes that finish
+ early stay in the batch idle, and one lane has nothing to write. Every lane
+ slows down to 0.61 times its rate half way through dst.
+ */
+int batch_test(int ndst)
+{
+    int i, l, num_done, num_errors = 0;
+    int nsrc = ndst * 4 + 4;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc * INP4FF_BATCH_LANES);
+    float* dst = (float*)malloc(sizeof(float) * ndst * INP4FF_BATCH_LANES);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst * INP4FF_BATCH_LANES);
+    int isrc [INP4FF_BATCH_LANES], idst [INP4FF_BATCH_LANES];
+    int nseg [INP4FF_BATCH_LANES], ndstseg [INP4FF_BATCH_LANES];
+    int num_to_write [INP4FF_BATCH_LANES], slowed [INP4FF_BATCH_LANES];
+    const float* seg_src [INP4FF_BATCH_LANES];
+    float* seg_dst [INP4FF_BATCH_LANES];
+    t_inp4ff_pos rate [INP4FF_BATCH_LANES];
+    inp4ff ref_interp [INP4FF_BATCH_LANES];
+    inp4ff_batch batch;
+
+    srand(17);
+    for (i = 0; i < nsrc * INP4FF_BATCH_LANES; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    inp4ff_batch_init(&batch);
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+    {
+        /* whole, sub-unity and above-unity rates, and a lane that stays idle */
+        num_to_write[l] = l == 3 ? 0 : ndst - l * 97;
+        rate[l] = (t_inp4ff_pos)(l % 3 == 0 ? 1 + l / 3 : 0.13 + 0.37 * l);
+
+        inp4ff_batch_start(&batch, l, num_to_write[l], 0);
+        ref_interp[l] = inp4ff_create(num_to_write[l], 0);
+        isrc[l] = 0; idst[l] = 0; nseg[l] = 0; ndstseg[l] = 0; slowed[l] = 0;
+    }
+
+    do {
+        num_done = 0;
+
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+        {
+            if (ref_interp[l].state == Inp4State_Done)
+            {
+                nseg[l] = 0;
+                ndstseg[l] = 0;
+                num_done++;
+            }
+            else
+            {
+                if (batch.state[l] != Inp4State_DstDepleted)
+                {
+                    isrc[l] += nseg[l];
+                    nseg[l] = rand() % 67 + 1;
+                    if (nseg[l] > nsrc - isrc[l]) nseg[l] = nsrc - isrc[l];
+                }
+
+                if (batch.state[l] != Inp4State_SrcDepleted)
+                {
+                    idst[l] += ndstseg[l];
+                    ndstseg[l] = rand() % 67 + 1;
+                    if (ndstseg[l] > ndst - idst[l]) ndstseg[l] = ndst - idst[l];
+
+                    if (idst[l] >= ndst / 2 && !slowed[l])
+                    {
+                        rate[l] *= (t_inp4ff_pos)0.61;
+                        slowed[l] = 1;
+                    }
+                }
+            }
+
+            seg_src[l] = src + l * nsrc + isrc[l];
+            seg_dst[l] = dst + l * ndst + idst[l];
+
+            if (ref_interp[l].state != Inp4State_Done)
+            {
+                inp4ff_process(&ref_interp[l], ref_dst + l * ndst + idst[l], ndstseg[l], seg_src[l], nseg[l], rate[l]);
+            }
+        }
+
+        inp4ff_process_batch(&batch, seg_dst, ndstseg, seg_src, nseg, rate);
+
+        for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+        {
+            if (batch.state[l] != ref_interp[l].state || batch.num_remaining[l] != ref_interp[l].num_remaining)
+            {
+                printf("ERROR lane %i state %i %i\n", l, batch.state[l], ref_interp[l].state);
+                num_errors++;
+            }
+        }
+
+    } while (num_done < INP4FF_BATCH_LANES && num_errors == 0);
+
+    for (l = 0; l < INP4FF_BATCH_LANES; ++l)
+    {
+        for (i = 0; i < num_to_write[l]; ++i)
+        {
+            error = fabs(ref_dst[l * ndst + i] - dst[l * ndst + i]);
+            if (error > tolerance)
+            {
+                printf("ERROR %i %i %.20f %.20f\n", l, i, ref_dst[l * ndst + i], dst[l * ndst + i]);
+                num_errors++;
+            }
+            if (error > max_error) max_error = error;
+        }
+    }
+
+    printf("Batch test (%i lanes) done, max error %g, %i errors encountered.\n", INP4FF_BATCH_LANES, max_error, num_errors);
+
+    free(src); free(dst); free(ref_dst);
+
+    return num_errors;
+}
+
+/**
+ Acquires every state of a pool, checks that the states are distinct and
+ line aligned, releases every third one and iterates over the rest, and
+ processes a state out of the pool against one created on its own.
+ */
+int pool_test(int capacity)
+{
+    int i, count, num_errors = 0;
+    float src [64], dst [32], ref_dst [32];
+    inp4ff** states = (inp4ff**)malloc(sizeof(inp4ff*) * capacity);
+    inp4ff ref_interp;
+    inp4ff_pool pool;
+
+    if (!inp4ff_pool_init(&pool, capacity))
+    {
+        printf("ERROR pool allocation\n");
+        free(states);
+        return 1;
+    }
+
+    for (i = 0; i < capacity; ++i)
+    {
+        states[i] = inp4ff_pool_acquire(&pool, 32, 0);
+
+        if (!states[i] || (size_t)states[i] % INP4FF_CACHE_LINE != 0 || (i > 0 && states[i] == states[i - 1]))
+        {
+            printf("ERROR acquire %i\n", i);
+            num_errors++;
+        }
+    }
+
+    if (inp4ff_pool_acquire(&pool, 32, 0) != 0)
+    {
+        printf("ERROR acquire past capacity\n");
+        num_errors++;
+    }
+
+    for (i = 0; i < capacity; i += 3)
+    {
+        inp4ff_pool_release(&pool, states[i]);
+    }
+
+    count = 0;
+    for (i = inp4ff_pool_next(&pool, -1); i >= 0; i = inp4ff_pool_next(&pool, i))
+    {
+        if (i % 3 == 0 || inp4ff_pool_at(&pool, i) != states[i])
+        {
+            printf("ERROR iterate %i\n", i);
+            num_errors++;
+        }
+        count++;
+    }
+
+    if (count != capacity - (capacity + 2) / 3)
+    {
+        printf("ERROR %i active\n", count);
+        num_errors++;
+    }
+
+    /* the released states are handed out again */
+    for (i = 0; i < capacity; i += 3)
+    {
+        states[i] = inp4ff_pool_acquire(&pool, 32, 0);
+        if (!states[i])
+        {
+            printf("ERROR reacquire %i\n", i);
+            num_errors++;
+        }
+    }
+
+    for (i = 0; i < 64; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    ref_interp = inp4ff_create(32, 0);
+    inp4ff_process(&ref_interp, ref_dst, 32, src, 64, 0.77f);
+    inp4ff_process(states[capacity / 2], dst, 32, src, 64, 0.77f);
+
+    for (i = 0; i < 32; ++i)
+    {
+        if (dst[i] != ref_dst[i])
+        {
+            printf("ERROR %i %.20f %.20f\n", i, ref_dst[i], dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Pool test (%i states of %i bytes) done, %i errors encountered.\n", capacity, (int)sizeof(inp4ff_slot), num_errors);
+
+    inp4ff_pool_free(&pool);
+    free(states);
+
+    return num_errors;
+}
+
+/**
+ Processes blocks of voices on a few shared src in the order of the scheduler
+ against each voice processed on its own, and checks that the order is a
+ permutation by growing address. Every third voice plays backwards.
+ */
+int scheduler_test(int num_voices, int nblock)
+{
+    int i, v, block, num_errors = 0;
+    const int nsrc = 4096, num_srcs = 4;
+    float* src = (float*)malloc(sizeof(float) * nsrc * num_srcs);
+    float* dst = (float*)malloc(sizeof(float) * nblock * num_voices);
+    float* ref_dst = (float*)malloc(sizeof(float) * nblock * num_voices);
+    inp4ff* states = (inp4ff*)malloc(sizeof(inp4ff) * num_voices);
+    inp4ff* ref_states = (inp4ff*)malloc(sizeof(inp4ff) * num_voices);
+    inp4ff_voice* voices = (inp4ff_voice*)malloc(sizeof(inp4ff_voice) * num_voices);
+    int* order = (int*)malloc(sizeof(int) * num_voices);
+    int* seen = (int*)malloc(sizeof(int) * num_voices);
+
+    srand(19);
+    for (i = 0; i < nsrc * num_srcs; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    for (v = 0; v < num_voices; ++v)
+    {
+        states[v] = ref_states[v] = inp4ff_create(nblock * 16, 0);
+        voices[v].interp = &states[v];
+        voices[v].dst = dst + v * nblock;
+        voices[v].ndst = nblock;
+        voices[v].src = src + (rand() % num_srcs) * nsrc;
+        voices[v].nsrc = nsrc;
+        voices[v].rate = (t_inp4ff_pos)(0.5 + 1.5 * rand() / RAND_MAX);
+        if (v % 3 == 0) voices[v].rate = -voices[v].rate;
+        order[v] = v;
+    }
+
+    for (block = 0; block < 16; ++block)
+    {
+        inp4ff_schedule(voices, order, num_voices);
+
+        for (v = 0; v < num_voices; ++v) seen[v] = 0;
+
+        for (i = 0; i < num_voices; ++i)
+        {
+            seen[order[i]]++;
+
+            if (i > 0 && (size_t)inp4ff__voice_address(&voices[order[i]]) < (size_t)inp4ff__voice_address(&voices[order[i - 1]]))
+            {
+                printf("ERROR order %i\n", i);
+                num_errors++;
+            }
+        }
+
+        for (v = 0; v < num_voices; ++v)
+        {
+            if (seen[v] != 1)
+            {
+                printf("ERROR voice %i scheduled %i times\n", v, seen[v]);
+                num_errors++;
+            }
+        }
+
+        inp4ff_process_voices(voices, order, num_voices);
+
+        for (v = 0; v < num_voices; ++v)
+        {
+            inp4ff_process(&ref_states[v], ref_dst + v * nblock, nblock, voices[v].src, nsrc, voices[v].rate);
+        }
+
+        for (i = 0; i < nblock * num_voices; ++i)
+        {
+            if (dst[i] != ref_dst[i])
+            {
+                printf("ERROR %i %i %.20f %.20f\n", block, i, ref_dst[i], dst[i]);
+                num_errors++;
+            }
+        }
+    }
+
+    printf("Scheduler test (%i voices) done, %i errors encountered.\n", num_voices, num_errors);
+
+    free(src); free(dst); free(ref_dst); free(states); free(ref_states); free(voices); free(order); free(seen);
+
+    return num_errors;
+}
+
+/**
+ Renders one src at several rates in a single pass with random segmentation,
+ against a state per rate processed on its own with the same segments. One
+ state finishes early.
+ */
+int rates_test(int ndst)
+{
+    static const float rates[] = { 0.5f, 1.0f, 2.0f, 1.0059f, 0.918f, 3.7f };
+    enum { K = sizeof(rates) / sizeof(rates[0]) };
+    int i, k, nseg, isrc = 0, num_errors = 0;
+    const int nsrc = (int)(ndst * 3.7f) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst * K);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst * K);
+    inp4ff states [K], ref_states [K];
+    inp4ff* interps [K];
+    float* dsts [K];
+    int ndsts [K];
+    t_inp4ff_pos pos_rates [K];
+
+    srand(21);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    for (k = 0; k < K; ++k)
+    {
+        ndsts[k] = k == 0 ? ndst / 3 : ndst;
+        states[k] = ref_states[k] = inp4ff_create(ndsts[k], 0);
+        interps[k] = &states[k];
+        dsts[k] = dst + k * ndst;
+        pos_rates[k] = rates[k];
+    }
+
+    while (isrc < nsrc)
+    {
+        /* short segments as well as long ones */
+        nseg = rand() % 2 ? rand() % 67 + 1 : rand() % 3000 + 1;
+        if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+
+        inp4ff_process_rates(interps, dsts, ndsts, K, src + isrc, nseg, pos_rates);
+
+        for (k = 0; k < K; ++k)
+        {
+            inp4ff_process(&ref_states[k], ref_dst + k * ndst, ndsts[k], src + isrc, nseg, pos_rates[k]);
+
+            if (states[k].state != ref_states[k].state)
+            {
+                printf("ERROR state %i %i %i\n", k, states[k].state, ref_states[k].state);
+                num_errors++;
+            }
+        }
+
+        isrc += nseg;
+    }
+
+    for (k = 0; k < K; ++k)
+    {
+        for (i = 0; i < ndsts[k]; ++i)
+        {
+            error = fabs(ref_dst[k * ndst + i] - dst[k * ndst + i]);
+            if (error > max_error) max_error = error;
+
+            if (error > tolerance)
+            {
+                printf("ERROR %i %i %.20f %.20f\n", k, i, ref_dst[k * ndst + i], dst[k * ndst + i]);
+                num_errors++;
+            }
+        }
+    }
+
+    printf("Rates test (%i rates) done, max error %g, %i errors encountered.\n", K, max_error, num_errors);
+
+    free(src); free(dst); free(ref_dst);
+
+    return num_errors;
+}
+
+/**
+ Processes complex src with random segmentation, against the scalar cubic
+ evaluated on linear copies of the real and the imaginary parts.
+ */
+int complex_test(int ndst, float rate)
+{
+    int i, ipos, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = (int)ceil(ndst * rate) + 3;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    t_inp4cf_pos pos = 0.0;
+    t_inp4cf_src* src = (t_inp4cf_src*)malloc(sizeof(t_inp4cf_src) * (nsrc + 1));
+    t_inp4cf_dst* dst = (t_inp4cf_dst*)malloc(sizeof(t_inp4cf_dst) * ndst);
+    float* re = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* im = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float ref_re, ref_im;
+
+    inp4cf interp;
+
+    /* src[0] is the initial state of the interpolator */
+    srand(23);
+    for (i = 0; i <= nsrc; ++i)
+    {
+        src[i].re = re[i] = i == 0 ? 0.0f : 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+        src[i].im = im[i] = i == 0 ? 0.0f : 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    interp = inp4cf_create(ndst, src[0]);
+
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4cf_process(&interp, dst + idst, ndstseg, src + 1 + isrc, nseg, rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ipos = (int)pos;
+        ref_re = reference_cubic(&re[ipos], pos - ipos);
+        ref_im = reference_cubic(&im[ipos], pos - ipos);
+        pos += rate;
+
+        error = fabs(ref_re - dst[i].re) > fabs(ref_im - dst[i].im) ? fabs(ref_re - dst[i].re) : fabs(ref_im - dst[i].im);
+        if (error > max_error) max_error = error;
+
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f %.20f\n", i, ref_re, dst[i].re, ref_im, dst[i].im);
+            num_errors++;
+        }
+    }
+
+    printf("Complex test (rate %f) done, max error %g, %i errors encountered.\n", rate, max_error, num_errors);
+
+    free(src); free(dst); free(re); free(im);
+
+    return num_errors;
+}
+
+/**
+ Mixes a voice into a bus holding earlier content with random segmentation,
+ against inp4ff_process into a scratch buffer added to the bus after.
+ */
+int mix_test(int ndst, float rate, float gain)
+{
+    int i, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = (int)(ndst * rate) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* bus = (float*)malloc(sizeof(float) * ndst);
+    float* ref_bus = (float*)malloc(sizeof(float) * ndst);
+    float* scratch = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+
+    srand(25);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (i = 0; i < ndst; ++i)
+    {
+        bus[i] = ref_bus[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4ff_process_mix(&interp, bus + idst, ndstseg, src + isrc, nseg, rate, gain);
+        inp4ff_process(&ref_interp, scratch + idst, ndstseg, src + isrc, nseg, rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ref_bus[i] += gain * scratch[i];
+
+        error = fabs(ref_bus[i] - bus[i]);
+        if (error > max_error) max_error = error;
+
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f\n", i, ref_bus[i], bus[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Mix test (rate %f, gain %f) done, max error %g, %i errors encountered.\n", rate, gain, max_error, num_errors);
+
+    free(src); free(bus); free(ref_bus); free(scratch);
+
+    return num_errors;
+}
+
+/**
+ Pans a voice into a stereo pair with a gain ramp over each dst segment and
+ random segmentation, against inp4ff_process into a scratch buffer with the
+ gains and the pan applied after. The pair holds earlier content, which is
+ either added to or overwritten.
+ */
+int stereo_test(int ndst, float rate, int accumulate)
+{
+    int i, j, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0;
+    int nsrc = (int)(ndst * rate) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = 2.0 * cubic_tolerance();
+    const float pan_left = 0.8f, pan_right = 0.6f;
+    float gain_start = 0.0f, gain_end = 0.0f, ref_left, ref_right;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* left = (float*)malloc(sizeof(float) * ndst);
+    float* right = (float*)malloc(sizeof(float) * ndst);
+    float* bus = (float*)malloc(sizeof(float) * ndst);
+    float* gains = (float*)malloc(sizeof(float) * ndst);
+    float* scratch = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+
+    srand(27);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (i = 0; i < ndst; ++i)
+    {
+        bus[i] = left[i] = right[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+
+        /* a new envelope segment from where the previous one ended */
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+
+            gain_start = gain_end;
+            gain_end = (float)rand() / (float)RAND_MAX;
+
+            for (j = 0; j < ndstseg; ++j)
+            {
+                gains[idst + j] = gain_start + j * ((gain_end - gain_start) / ndstseg);
+            }
+        }
+
+        inp4ff_process_stereo(&interp, left + idst, right + idst, ndstseg, src + isrc, nseg, rate,
+                              gain_start, gain_end, pan_left, pan_right, accumulate);
+        inp4ff_process(&ref_interp, scratch + idst, ndstseg, src + isrc, nseg, rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ref_left = (accumulate ? bus[i] : 0.0f) + pan_left * gains[i] * scratch[i];
+        ref_right = (accumulate ? bus[i] : 0.0f) + pan_right * gains[i] * scratch[i];
+
+        error = fabs(ref_left - left[i]) > fabs(ref_right - right[i]) ? fabs(ref_left - left[i]) : fabs(ref_right - right[i]);
+        if (error > max_error) max_error = error;
+
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f %.20f\n", i, ref_left, left[i], ref_right, right[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Stereo test (rate %f, %s) done, max error %g, %i errors encountered.\n",
+           rate, accumulate ? "accumulate" : "write", max_error, num_errors);
+
+    free(src); free(left); free(right); free(bus); free(gains); free(scratch);
+
+    return num_errors;
+}
+
+#ifndef INP4FF_USE_INDEXED_POS
+/**
+ Sweeps the rate per output with inp4ff_process_varirate over random src and
+ dst segmentation, against the scalar cubic at positions accumulated from the
+ same rates. depth is the swing of the rate around centre, the rates below 0
+ hold the position.
+ */
+int varirate_test(int ndst, float centre, float depth)
+{
+    int i, ipos, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0, nsrc;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    t_inp4ff_phase pos = 0;
+    float ref;
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * ndst);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    float* src;
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        rates[i] = centre + depth * (t_inp4ff_pos)sin(0.01 * i);
+        pos += inp4ff__phase_rate(rates[i] > 0 ? rates[i] : 0);
+    }
+
+#ifdef INP4FF_USE_FIXED_POS
+    nsrc = (int)(pos >> 32) + 4;
+#else
+    nsrc = (int)pos + 4;
+#endif
+
+    /* src[0] is the initial state of the interpolator */
+    src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    srand(31);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+#ifdef INP4FF_USE_FLOAT32_POS
+            /* a float position is rounded differently each time src moves on */
+            nseg = nsrc;
+#endif
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        inp4ff_process_varirate(&interp, dst + idst, ndstseg, src + 1 + isrc, nseg, rates + idst);
+
+    } while (interp.state != Inp4State_Done);
+
+    pos = 0;
+    for (i = 0; i < ndst; ++i)
+    {
+#ifdef INP4FF_USE_FIXED_POS
+        ipos = (int)(pos >> 32);
+        ref = reference_cubic(&src[ipos], INP4FF_PHASE_FRACT(pos));
+#else
+        ipos = (int)pos;
+        ref = reference_cubic(&src[ipos], pos - ipos);
+#endif
+        pos += inp4ff__phase_rate(rates[i] > 0 ? rates[i] : 0);
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Varirate test (rate %f +- %f) done, max error %g, %i errors encountered.\n",
+           centre, depth, max_error, num_errors);
+
+    free(rates); free(dst); free(src);
+
+    return num_errors;
+}
+#endif
+
+#ifndef INP4FF_USE_INDEXED_POS
+/**
+ Glides the rate from one random rate to the next over each dst block with
+ inp4ff_process_ramp, with random segmentation of src, against the scalar
+ cubic at the positions of the glide added up in double precision. With
+ float positions the rounding of the position drifts as src moves on, which
+ the tolerance allows for.
+ */
+int ramp_test(int ndst, float max_rate)
+{
+    int i, k, ipos, nseg, ndstseg, isrc = 0, idst = 0, num_errors = 0, nsrc;
+    double error, max_error = 0.0, pos, ref_pos;
+#ifdef INP4FF_USE_FLOAT32_POS
+    const double tolerance = cubic_tolerance() + 1e-3;
+#else
+    const double tolerance = cubic_tolerance();
+#endif
+    t_inp4ff_pos rate_start, rate_end = 1.0f;
+    t_inp4ff_phase rate, step;
+    float ref;
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    double* positions = (double*)malloc(sizeof(double) * ndst);
+    int* blocks = (int*)malloc(sizeof(int) * (ndst + 1));
+    t_inp4ff_pos* rates = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * (ndst + 1));
+    float* src;
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* the blocks and their rates, and the positions of the glides */
+    srand(37);
+    pos = 0.0;
+    rates[0] = rate_end;
+    for (i = 0, k = 0; i < ndst; i += blocks[k++])
+    {
+        blocks[k] = rand() % 600 + 1;
+        if (blocks[k] > ndst - i) blocks[k] = ndst - i;
+
+        rate_start = rate_end;
+        rate_end = (t_inp4ff_pos)(0.05 + (max_rate - 0.05) * rand() / RAND_MAX);
+        rates[k + 1] = rate_end;
+
+        rate = inp4ff__phase_rate(rate_start);
+        step = inp4ff__ramp_step(rate, inp4ff__phase_rate(rate_end), blocks[k]);
+
+        for (ndstseg = 0; ndstseg < blocks[k]; ++ndstseg)
+        {
+            positions[i + ndstseg] = pos;
+#ifdef INP4FF_USE_FIXED_POS
+            pos += (double)(rate + ndstseg * step) / INP4FF_PHASE_SCALE;
+#else
+            pos += (double)rate + ndstseg * (double)step;
+#endif
+        }
+    }
+
+    nsrc = (int)pos + 4;
+
+    /* src[0] is the initial state of the interpolator */
+    src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    nseg = 0; ndstseg = 0; k = -1;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc += nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > nsrc - isrc) nseg = nsrc - isrc;
+        }
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = blocks[++k];
+        }
+
+        inp4ff_process_ramp(&interp, dst + idst, ndstseg, src + 1 + isrc, nseg, rates[k], rates[k + 1]);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        ref_pos = positions[i];
+        ipos = (int)ref_pos;
+        ref = reference_cubic(&src[ipos], (t_inp4ff_pos)(ref_pos - ipos));
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Ramp test (rate up to %f) done, max error %g, %i errors encountered.\n", max_rate, max_error, num_errors);
+
+    free(dst); free(positions); free(blocks); free(rates); free(src);
+
+    return num_errors;
+}
+#endif
+
+/**
+ Writes blocks of random length to a delay line and reads each back at a
+ swept delay, through the wrap around of the buffer, against the scalar cubic
+ on a linear copy of everything written with silence in front.
+ */
+int delay_test(int size, int num_samples)
+{
+    int i, k, n, ipos, written = 0, num_errors = 0;
+    double error, max_error = 0.0;
+    const double tolerance = cubic_tolerance();
+    t_inp4ff_pos t;
+    float ref, dst [64];
+    t_inp4ff_pos delays [64];
+    float* lin;
+    inp4ff_delay delay;
+
+    /* the size gets rounded up to a power of two */
+    size = inp4ff_delay_init(&delay, size);
+    lin = (float*)calloc(size + num_samples + 64, sizeof(float));
+
+    srand(41);
+    for (i = 0; i < num_samples + 64; ++i)
+    {
+        lin[size + i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    while (written < num_samples)
+    {
+        n = rand() % 64 + 1;
+
+        inp4ff_delay_write(&delay, lin + size + written, n);
+
+        /* a chorus sweep over nearly all of the buffer */
+        for (i = 0; i < n; ++i)
+        {
+            delays[i] = (t_inp4ff_pos)(2.0 + (size - n - 3) * (0.5 + 0.5 * sin(0.001 * (written + i))));
+        }
+
+        inp4ff_delay_read(&delay, dst, n, delays);
+
+        for (i = 0; i < n; ++i)
+        {
+            t = (t_inp4ff_pos)i - delays[i];
+            k = INP4FF_FLOOR_INT(t);
+            ipos = size + written + k - 1;
+            ref = reference_cubic(&lin[ipos], t - k);
+
+            error = fabs(ref - dst[i]);
+            if (error > max_error) max_error = error;
+            if (error > tolerance)
+            {
+                printf("ERROR %i %.20f %.20f %.20f\n", written + i, ref, dst[i], ref - dst[i]);
+                num_errors++;
+            }
+        }
+
+        written += n;
+    }
+
+    printf("Delay test (size %i) done, max error %g, %i errors encountered.\n", size, max_error, num_errors);
+
+    inp4ff_delay_free(&delay);
+    free(lin);
+
+    return num_errors;
+}
+
+/**
+ Reads num_taps taps of a delay line per block with inp4ff_delay_read_taps,
+ with new random delays for each block, against the scalar cubic on a linear
+ copy as in delay_test. The taps turn the cubic into weights, so the
+ rounding may differ by a few ulp.
+ */
+int taps_test(int size, int num_taps)
+{
+    int i, j, k, n, written = 0, num_errors = 0;
+    const int num_samples = 10000;
+    double error, max_error = 0.0;
+    const double tolerance = 2.0 * cubic_tolerance();
+    t_inp4ff_pos t;
+    float ref;
+    float* out [32];
+    t_inp4ff_pos delays [32];
+    float* lin;
+    inp4ff_delay delay;
+
+    size = inp4ff_delay_init(&delay, size);
+    lin = (float*)calloc(size + num_samples + 64, sizeof(float));
+
+    for (j = 0; j < num_taps; ++j)
+    {
+        out[j] = (float*)malloc(sizeof(float) * 64);
+    }
+
+    srand(43);
+    for (i = 0; i < num_samples + 64; ++i)
+    {
+        lin[size + i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    while (written < num_samples)
+    {
+        n = rand() % 64 + 1;
+
+        inp4ff_delay_write(&delay, lin + size + written, n);
+
+        for (j = 0; j < num_taps; ++j)
+        {
+            delays[j] = (t_inp4ff_pos)(2.0 + (size - n - 3) * (double)rand() / RAND_MAX);
+        }
+
+        inp4ff_delay_read_taps(&delay, out, n, delays, num_taps);
+
+        for (j = 0; j < num_taps; ++j)
+        {
+            t = -delays[j];
+            k = INP4FF_FLOOR_INT(t);
+
+            for (i = 0; i < n; ++i)
+            {
+                ref = reference_cubic(&lin[size + written + i + k - 1], t - k);
+
+                error = fabs(ref - out[j][i]);
+                if (error > max_error) max_error = error;
+                if (error > tolerance)
+                {
+                    printf("ERROR %i %i %.20f %.20f %.20f\n", written + i, j, ref, out[j][i], ref - out[j][i]);
+                    num_errors++;
+                }
+            }
+        }
+
+        written += n;
+    }
+
+    printf("Taps test (size %i, %i taps) done, max error %g, %i errors encountered.\n", size, num_taps, max_error, num_errors);
+
+    for (j = 0; j < num_taps; ++j)
+    {
+        free(out[j]);
+    }
+    inp4ff_delay_free(&delay);
+    free(lin);
+
+    return num_errors;
+}
+
+/**
+ Plays src backwards with a negative rate, src given as segments from its end
+ to its start, against a forward pass over a reversed copy of src cut to the
+ same segments. dst is segmented randomly.
+ */
+int reverse_test(int ndst, float rate)
+{
+    int i, nseg, ndstseg, isrc, idst = 0, num_errors = 0;
+    int nsrc = (int)ceil(ndst * rate) + 4;
+    double error, max_error = 0.0;
+    const double tolerance = 2.0 * cubic_tolerance();
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* reversed = (float*)malloc(sizeof(float) * nsrc);
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+
+    srand(47);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+        reversed[nsrc - 1 - i] = src[i];
+    }
+
+    isrc = nsrc; nseg = 0; ndstseg = 0;
+    do {
+        if (interp.state != Inp4State_DstDepleted)
+        {
+            isrc -= nseg;
+            nseg = rand() % 67 + 1;
+            if (nseg > isrc) nseg = isrc;
+        }
+        if (interp.state != Inp4State_SrcDepleted)
+        {
+            idst += ndstseg;
+            ndstseg = rand() % 67 + 1;
+            if (ndstseg > ndst - idst) ndstseg = ndst - idst;
+        }
+
+        /* the segment before the previous one, and the same of the copy */
+        inp4ff_process(&interp, dst + idst, ndstseg, src + isrc - nseg, nseg, -rate);
+        inp4ff_process(&ref_interp, ref_dst + idst, ndstseg, reversed + nsrc - isrc, nseg, rate);
+
+    } while (interp.state != Inp4State_Done);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        error = fabs(ref_dst[i] - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref_dst[i], dst[i], ref_dst[i] - dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Reverse test (rate %f) done, max error %g, %i errors encountered.\n", -rate, max_error, num_errors);
+
+    free(src); free(reversed); free(dst); free(ref_dst);
+
+    return num_errors;
+}
+
+/**
+ Scrubs back and forth over one src, turning the sign of the rate between
+ calls, against the scalar cubic at the positions turned around by hand. The
+ forward stretches after a backward one go through inp4ff_process_strided
+ and inp4ff_process_varirate, which turn the state back themselves. With
+ indexed positions, which have no varirate, the last one goes through
+ inp4ff_process.
+ */
+int scrub_test()
+{
+    static const float rates[] = { 1.3f, -0.7f, 2.0f, -3.1f, 0.45f };
+    static const int lengths[] = { 1000, 800, 600, 400, 500 };
+    int i, k, ipos, idst = 0, backward = 0, num_errors = 0;
+    const int ndst = 3300, nsrc = 2000;
+    const double tolerance = 2.0 * cubic_tolerance();
+    double at, error, max_error = 0.0;
+    t_inp4ff_pos pos = 0;
+    float ref;
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 1));
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+    t_inp4ff_pos* step = (t_inp4ff_pos*)malloc(sizeof(t_inp4ff_pos) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* src[0] is the initial state of the interpolator */
+    srand(53);
+    src[0] = 0.0f;
+    for (i = 1; i <= nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    for (k = 0; k < 5; ++k)
+    {
+        if (k == 2)
+        {
+            inp4ff_process_strided(&interp, dst + idst, lengths[k], 1, src + 1, nsrc, 1, rates[k]);
+        }
+#ifndef INP4FF_USE_INDEXED_POS
+        else if (k == 4)
+        {
+            for (i = 0; i < lengths[k]; ++i) step[i] = rates[k];
+            inp4ff_process_varirate(&interp, dst + idst, lengths[k], src + 1, nsrc, step);
+        }
+#endif
+        else
+        {
+            inp4ff_process(&interp, dst + idst, lengths[k], src + 1, nsrc, rates[k]);
+        }
+
+        /* the position runs up from the end of src while going backward */
+        if ((rates[k] < 0) != backward)
+        {
+            pos = (t_inp4ff_pos)(nsrc - 1) - pos;
+            backward = !backward;
+        }
+
+        for (i = 0; i < lengths[k]; ++i, ++idst)
+        {
+            at = backward ? (nsrc - 1) - (double)pos : (double)pos;
+            ipos = (int)at;
+            ref = reference_cubic(&src[ipos], (t_inp4ff_pos)(at - ipos));
+            pos += (t_inp4ff_pos)fabs(rates[k]);
+
+            error = fabs(ref - dst[idst]);
+            if (error > max_error) max_error = error;
+            if (error > tolerance)
+            {
+                printf("ERROR %i %.20f %.20f %.20f\n", idst, ref, dst[idst], ref - dst[idst]);
+                num_errors++;
+            }
+        }
+    }
+
+    printf("Scrub test done, max error %g, %i errors encountered.\n", max_error, num_errors);
+
+    free(src); free(dst); free(step);
+
+    return num_errors;
+}
+
+/**
+ Reads src through at rate, then turns back over it and forward again
+ through inp4ff_process_strided, against the scalar cubic at the positions
+ turned around by hand. Past the end of src the samples are held at its last
+ one, as the context holds them at the turn.
+ */
+int turn_back_test(float rate)
+{
+    static const float back_rate = -0.9f, forth_rate = 1.1f;
+    static const int back_length = 300, forth_length = 200;
+    int i, ipos, num_read, num_errors = 0;
+    const int ndst = 2000, nsrc = 500;
+    const double tolerance = 2.0 * cubic_tolerance();
+    double at, error, max_error = 0.0;
+    t_inp4ff_pos pos = 0;
+    float ref;
+    float* src = (float*)malloc(sizeof(float) * (nsrc + 8));
+    float* dst = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff interp = inp4ff_create(ndst, 0);
+
+    /* src[0] is the initial state of the interpolator, and the last sample
+       repeats past the end */
+    srand(61);
+    src[0] = 0.0f;
+    for (i = 1; i < nsrc + 8; ++i)
+    {
+        src[i] = i <= nsrc ? 2.0f * (float)rand() / (float)RAND_MAX - 1.0f : src[nsrc];
+    }
+
+    inp4ff_process(&interp, dst, ndst, src + 1, nsrc, rate);
+    num_read = interp.dst_index;
+
+    if (interp.state != Inp4State_SrcDepleted)
+    {
+        printf("ERROR src not read through\n");
+        num_errors++;
+    }
+
+    /* the same src again, going back from where the first call left off */
+    inp4ff_process(&interp, dst, num_read + back_length, src + 1, nsrc, back_rate);
+    inp4ff_process_strided(&interp, dst + num_read + back_length, forth_length, 1, src + 1, nsrc, 1, forth_rate);
+
+    for (i = 0; i < num_read + back_length + forth_length; ++i)
+    {
+        /* the position runs up from the end of src while going backward */
+        if (i == num_read || i == num_read + back_length)
+        {
+            pos = (t_inp4ff_pos)(nsrc - 1) - pos;
+        }
+
+        at = i >= num_read && i < num_read + back_length ? (nsrc - 1) - (double)pos : (double)pos;
+        ipos = (int)at;
+        ref = reference_cubic(&src[ipos], (t_inp4ff_pos)(at - ipos));
+        pos += i < num_read ? rate : i < num_read + back_length ? -back_rate : forth_rate;
+
+        error = fabs(ref - dst[i]);
+        if (error > max_error) max_error = error;
+        if (error > tolerance)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref, dst[i], ref - dst[i]);
+            num_errors++;
+        }
+    }
+
+    printf("Turn back test (rate %f) done, max error %g, %i errors encountered.\n", rate, max_error, num_errors);
+
+    free(src); free(dst);
+
+    return num_errors;
+}
+
+/**
+ Checks the rows of the shared table at whole positions, and that the
+ quantization error falls with the table size. Prints the error in dB.
+ */
+#ifdef INP4FF_USE_LUT
+int lut_test()
+{
+    int i, num_phases, num_errors = 0;
+    double error_db, prev_error_db = 0.0;
+    const float first [4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+    const float last [4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+
+    inp4_lut_init();
+
+    for (i = 0; i < 4; ++i)
+    {
+        if (inp4_lut[i] != first[i] || inp4_lut[INP4_LUT_PHASES * 4 + i] != last[i])
+        {
+            printf("ERROR tap %i %f %f\n", i, inp4_lut[i], inp4_lut[INP4_LUT_PHASES * 4 + i]);
+            num_errors++;
+        }
+    }
+
+    for (num_phases = 64; num_phases <= 8192; num_phases *= 2)
+    {
+        error_db = inp4_lut_error_db(num_phases);
+        printf("%5i phases: %.1f dB\n", num_phases, error_db);
+
+        if (num_phases > 64 && error_db > prev_error_db - 5.0)
+        {
+            printf("ERROR error doesn't fall with the table size\n");
+            num_errors++;
+        }
+        prev_error_db = error_db;
+    }
+
+    printf("LUT test done, %i errors encountered.\n", num_errors);
+
+    return num_errors;
+}
+#endif
+
+#ifdef TEST_LIBRARY
+/** Compares the runtime dispatched library kernels to the header-only ones */
+int library_test(int ndst, float rate)
+{
+    int i, num_errors = 0;
+    int nsrc = (int)ceil(ndst * rate) + 2;
+    float* src = (float*)malloc(sizeof(float) * nsrc);
+    float* ref_dst = (float*)malloc(sizeof(float) * ndst);
+    float* lib_dst = (float*)malloc(sizeof(float) * ndst);
+
+    inp4ff ref_interp = inp4ff_create(ndst, 0);
+    inp4ff lib_interp = inp4ff_create(ndst, 0);
+
+    srand(3);
+    for (i = 0; i < nsrc; ++i)
+    {
+        src[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    inp4ff_process(&ref_interp, ref_dst, ndst, src, nsrc, rate);
+    inp4lib_ff_process(&lib_interp, lib_dst, ndst, src, nsrc, rate);
+
+    for (i = 0; i < ndst; ++i)
+    {
+        if (fabs(ref_dst[i] - lib_dst[i]) > 4.0 * 1.1920929e-7)
+        {
+            printf("ERROR %i %.20f %.20f %.20f\n", i, ref_dst[i], lib_dst[i], ref_dst[i] - lib_dst[i]);
+            num_errors++;
+        }
+    }
+
+    if (ref_interp.state != lib_interp.state || ref_interp.position != lib_interp.position)
+    {
+        printf("ERROR: states differ\n");
+        num_errors++;
+    }
+
+    printf("Library test (%s, rate %f) done, %i errors encountered.\n", inp4lib_isa(), rate, num_errors);
+
+    free(src); free(ref_dst); free(lib_dst);
+
+    return num_errors;
+}
+#endif
+
+int main()
+{
+    int num_errors = 0;
+
+    num_errors += simd_test(4099, 0.1f);
+    num_errors += simd_test(4099, 0.77f);
+    num_errors += simd_test(4099, 1.0f);
+    num_errors += simd_test(4099, 3.3f);
+
+#if defined(INP4FF_USE_FIXED_POS) || defined(INP4FF_USE_INDEXED_POS)
+    num_errors += exact_segmented_test(4099, 0.1f);
+    num_errors += exact_segmented_test(4099, 0.77f);
+    num_errors += exact_segmented_test(4099, 2.3f);
+#endif
+
+    num_errors += passthrough_test(4099, 1);
+    num_errors += passthrough_test(4099, 2);
+    num_errors += passthrough_test(4099, 3);
+    num_errors += rate_change_test(20000);
+
+    num_errors += ratio_test(4099, 160, 147);
+    num_errors += ratio_test(4099, 2, 1);
+    num_errors += ratio_test(4099, 1001, 1000);
+    num_errors += ratio_test(4099, 1000, 1001);
+    num_errors += ratio_test(4099, 3, 7);
+
+    num_errors += multichannel_test(4099, 1, 0.77f, 0);
+    num_errors += multichannel_test(4099, 2, 0.77f, 0);
+    num_errors += multichannel_test(4099, 4, 1.0f, 0);
+    num_errors += multichannel_test(4099, 4, 0.918f, 0);
+    num_errors += multichannel_test(4099, 5, 1.7f, 0);
+    num_errors += multichannel_test(4099, 6, 1.3f, 0);
+    num_errors += multichannel_test(4099, 8, 0.77f, 0);
+    num_errors += multichannel_test(4099, 8, 2.0f, 0);
+
+    num_errors += multichannel_test(4099, 1, 0.77f, 1);
+    num_errors += multichannel_test(4099, 3, 0.1f, 1);
+    num_errors += multichannel_test(4099, 8, 1.3f, 1);
+    num_errors += multichannel_test(4099, 8, 3.7f, 1);
+
+    num_errors += strided_test(4099, 1, 1, 0.77f);
+    num_errors += strided_test(4099, 2, 1, 0.77f);
+    num_errors += strided_test(4099, 1, 6, 1.3f);
+    num_errors += strided_test(4099, 8, 2, 3.7f);
+
+    num_errors += batch_test(4099);
+    num_errors += pool_test(1000);
+    num_errors += scheduler_test(512, 32);
+    num_errors += rates_test(20000);
+    num_errors += complex_test(10000, 0.918f);
+    num_errors += complex_test(10000, 1.0f);
+    num_errors += complex_test(10000, 2.0f);
+    num_errors += complex_test(10000, 3.7f);
+    num_errors += mix_test(10000, 0.918f, 0.5f);
+    num_errors += mix_test(10000, 1.0f, -0.25f);
+    num_errors += mix_test(10000, 2.0f, 1.0f);
+    num_errors += mix_test(10000, 3.7f, 0.7f);
+    num_errors += stereo_test(10000, 0.918f, 1);
+    num_errors += stereo_test(10000, 1.0f, 0);
+    num_errors += stereo_test(10000, 3.7f, 1);
+#ifndef INP4FF_USE_INDEXED_POS
+    num_errors += varirate_test(10000, 1.0f, 0.3f);
+    num_errors += varirate_test(10000, 0.5f, 0.45f);
+    num_errors += varirate_test(10000, 2.2f, 1.5f);
+    num_errors += varirate_test(10000, 0.3f, 0.9f);
+    num_errors += ramp_test(10000, 1.0f);
+    num_errors += ramp_test(10000, 3.7f);
+#endif
+    num_errors += delay_test(256, 10000);
+    num_errors += delay_test(1000, 10000);
+    num_errors += taps_test(256, 8);
+    num_errors += taps_test(4096, 32);
+    num_errors += reverse_test(10000, 0.918f);
+    num_errors += reverse_test(10000, 1.0f);
+    num_errors += reverse_test(10000, 3.7f);
+    num_errors += scrub_test();
+    num_errors += turn_back_test(1.3f);
+    num_errors += turn_back_test(3.7f);
+
+#ifdef INP4FF_USE_LUT
+    num_errors += lut_test();
+#endif
+
+#ifdef TEST_LIBRARY
+    num_errors += library_test(4099, 0.3f);
+    num_errors += library_test(4099, 1.7f);
+#endif
+
+#if 0
+    float rate = 0.1;
+    
+    naive_test(32);
+    
+    //while (rate < 8)
+    {
+        segmented_rw_test(4096, rate);
+        rate += 0.1;
+    }
+#endif
+    //linear_drift_test(512, 0.1);
+    drift_test(512, 0.1);
+
+    return num_errors != 0;
 }